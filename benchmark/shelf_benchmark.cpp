@@ -0,0 +1,324 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Headless throughput benchmark of the shelf simulation.
+//
+// Runs ShelfEngine as fast as possible against the in-process client stub
+// in stubs/ and reports, for every worker count given:
+//   - published resource updates per second
+//   - p50 and p99 real time from a change to its publication
+//   - heap allocations per update while running
+//
+// Usage: shelf_benchmark [shelves] [seconds] [workers,workers,...]
+//
+// The state files of the application are removed before each run, so
+// every run starts from fresh shelves. A scenario.txt or
+// product_catalog.bin in the working directory is used as on a device.
+
+#include "simplem2mclient.h"
+#include "shelf_engine.h"
+#include "offline_buffer.h"
+#include "shelf_journal.h"
+
+#include <new>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCHMARK_SEED 1
+#define BENCHMARK_MAX_RUNS 16
+
+static volatile uint64_t allocations = 0;
+
+static void count_allocation()
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+}
+
+static uint64_t allocation_count()
+{
+    return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+// The link wraps the C allocator of the application sources, see
+// CMakeLists.txt, and the C++ operators are replaced here.
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    count_allocation();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    count_allocation();
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    count_allocation();
+    return __real_realloc(pointer, size);
+}
+}
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+    count_allocation();
+    void *pointer = __real_malloc(size ? size : 1);
+    if (pointer == NULL) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) throw()
+{
+    count_allocation();
+    return __real_malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) throw()
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *pointer) throw()
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer) throw()
+{
+    free(pointer);
+}
+
+/**
+ * \brief Histogram of latencies in microseconds, with 16 buckets per power
+ *        of two, so percentiles are within 1/16 of the real value.
+ */
+class LatencyHistogram
+{
+    enum {
+        SUB_BITS    = 4,
+        SUB_COUNT   = 1 << SUB_BITS,
+        BUCKETS     = (32 - SUB_BITS + 1) * SUB_COUNT
+    };
+
+public:
+    LatencyHistogram()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        memset(_counts, 0, sizeof(_counts));
+        _total = 0;
+    }
+
+    void add(uint32_t latency_us)
+    {
+        _counts[bucket(latency_us)]++;
+        _total++;
+    }
+
+    uint64_t total() const
+    {
+        return _total;
+    }
+
+    /**
+     * \brief Returns the upper bound of the bucket holding the given
+     *        percentile.
+     */
+    uint32_t percentile(uint32_t percent) const
+    {
+        uint64_t rank = (_total * percent + 99) / 100;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += _counts[i];
+            if (seen >= rank && seen > 0) {
+                return lower_bound(i + 1) - 1;
+            }
+        }
+        return 0;
+    }
+
+private:
+    static int bucket(uint32_t value)
+    {
+        if (value < SUB_COUNT) {
+            return value;
+        }
+        int shift = (31 - __builtin_clz(value)) - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + ((value >> shift) & (SUB_COUNT - 1));
+    }
+
+    static uint32_t lower_bound(int bucket)
+    {
+        if (bucket < SUB_COUNT) {
+            return bucket;
+        }
+        int shift = bucket / SUB_COUNT - 1;
+        return (uint32_t)((uint64_t)(SUB_COUNT + bucket % SUB_COUNT) << shift);
+    }
+
+private:
+    uint64_t    _counts[BUCKETS];
+    uint64_t    _total;
+};
+
+struct Run {
+    SimpleM2MClient *client;
+    uint32_t        seconds;
+};
+
+static void record_latency(uint32_t latency_us, void *context)
+{
+    ((LatencyHistogram*)context)->add(latency_us);
+}
+
+static void *stop_after(void *argument)
+{
+    Run *run = (Run*)argument;
+    sleep(run->seconds);
+    run->client->close();
+    return NULL;
+}
+
+static void remove_state()
+{
+    static const char *const files[] = {
+        SHELF_JOURNAL_CHECKPOINT_A,
+        SHELF_JOURNAL_CHECKPOINT_B,
+        SHELF_JOURNAL_WAL_FILE,
+        OFFLINE_BUFFER_FILE_NAME
+    };
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+        if (mcc_platform_get_storage_file_path(files[i], path, sizeof(path)) == 0) {
+            pal_fsUnlink(path);
+        }
+    }
+
+    for (unsigned i = 0; i < SHELF_HISTORY_FILE_COUNT; i++) {
+        char name[32];
+        char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+        snprintf(name, sizeof(name), SHELF_HISTORY_FILE_NAME, i);
+        if (mcc_platform_get_storage_file_path(name, path, sizeof(path)) == 0) {
+            pal_fsUnlink(path);
+        }
+    }
+}
+
+static bool benchmark(uint16_t shelves, uint32_t seconds, uint16_t workers, LatencyHistogram &latencies)
+{
+    remove_state();
+
+    SimpleM2MClient client;
+    ShelfEngine engine;
+    if (!engine.create_shelves(client, shelves, workers)) {
+        return false;
+    }
+    engine.set_publish_callback(record_latency, &latencies);
+    client.register_and_connect();
+    if (!client.wait_for_registration(1000)) {
+        printf("Stub client did not register\n");
+        return false;
+    }
+    engine.start(BENCHMARK_SEED, 0);
+
+    // Only count what happens while running.
+    latencies.reset();
+    uint64_t notifications = M2MBase::notification_count();
+    uint64_t allocations = allocation_count();
+    uint64_t started = SimClock::real_now_us();
+
+    Run run;
+    run.client = &client;
+    run.seconds = seconds;
+    pthread_t stopper;
+    if (pthread_create(&stopper, NULL, stop_after, &run) != 0) {
+        return false;
+    }
+    engine.run(client);
+    pthread_join(stopper, NULL);
+
+    uint64_t elapsed = SimClock::real_now_us() - started;
+    allocations = allocation_count() - allocations;
+    notifications = M2MBase::notification_count() - notifications;
+    uint64_t updates = latencies.total();
+
+    printf("RESULT workers=%u shelves=%u updates=%llu updates/s=%llu p50_us=%lu p99_us=%lu "
+           "allocations/update=%.4f notifications/s=%llu\n",
+           (unsigned int)workers, (unsigned int)shelves,
+           (unsigned long long)updates,
+           (unsigned long long)(elapsed ? updates * 1000000 / elapsed : 0),
+           (unsigned long)latencies.percentile(50),
+           (unsigned long)latencies.percentile(99),
+           updates ? (double)allocations / updates : 0.0,
+           (unsigned long long)(elapsed ? notifications * 1000000 / elapsed : 0));
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t shelves = (argc > 1) ? (uint16_t)atoi(argv[1]) : 1000;
+    uint32_t seconds = (argc > 2) ? (uint32_t)atoi(argv[2]) : 10;
+    const char *worker_list = (argc > 3) ? argv[3] : "0";
+
+    if (shelves == 0 || seconds == 0) {
+        printf("Usage: %s [shelves] [seconds] [workers,workers,...]\n", argv[0]);
+        return 1;
+    }
+
+    LatencyHistogram latencies;
+
+    int runs = 0;
+    const char *next = worker_list;
+    while (*next != '\0' && runs < BENCHMARK_MAX_RUNS) {
+        char *end;
+        unsigned long workers = strtoul(next, &end, 10);
+        if (end == next) {
+            printf("Invalid worker count list: %s\n", worker_list);
+            return 1;
+        }
+        if (!benchmark(shelves, seconds, (uint16_t)workers, latencies)) {
+            printf("Benchmark with %lu workers failed\n", workers);
+            return 1;
+        }
+        runs++;
+        next = (*end == ',') ? end + 1 : end;
+    }
+
+    remove_state();
+    return 0;
+}
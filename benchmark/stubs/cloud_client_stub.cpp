@@ -0,0 +1,70 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "mbed-cloud-client/MbedCloudClient.h"
+
+MbedCloudClient::MbedCloudClient() : _objects(NULL)
+{
+    _endpoint.endpoint_name = String("shelf-benchmark");
+    _endpoint.internal_endpoint_name = String("0000000000000000000000000000b3c4");
+}
+
+void MbedCloudClient::add_objects(const M2MObjectList &object_list)
+{
+    _objects = &object_list;
+}
+
+bool MbedCloudClient::setup(void *iface)
+{
+    (void)iface;
+    set_registered(true);
+    return true;
+}
+
+void MbedCloudClient::close()
+{
+    _on_unregistered.call();
+}
+
+void MbedCloudClient::register_update()
+{
+}
+
+const ConnectorClientEndpointInfo *MbedCloudClient::endpoint_info() const
+{
+    return &_endpoint;
+}
+
+const char *MbedCloudClient::error_description() const
+{
+    return "stubbed client";
+}
+
+void MbedCloudClient::set_registered(bool registered)
+{
+    if (registered) {
+        _on_registered.call();
+    } else {
+        report_error(ConnectNetworkError);
+    }
+}
+
+void MbedCloudClient::report_error(Error error)
+{
+    _on_error.call(error);
+}
@@ -0,0 +1,187 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "nanostack-event-loop/eventOS_event.h"
+#include "nanostack-event-loop/eventOS_event_timer.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+// Like the client event loop, one thread runs every handler in turn. It
+// is started by the first handler and runs until the process exits.
+
+#define EVENT_LOOP_STUB_HANDLERS    16
+#define EVENT_LOOP_STUB_EVENTS      32
+
+struct arm_event_storage {
+    arm_event_t event;
+    uint64_t    due_ms;
+    uint32_t    period_ms;
+    bool        used;
+};
+
+static pthread_mutex_t loop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loop_changed;
+static bool loop_started = false;
+static void (*handlers[EVENT_LOOP_STUB_HANDLERS])(arm_event_s*);
+static int8_t handler_count = 0;
+static arm_event_storage_t events[EVENT_LOOP_STUB_EVENTS];
+
+static uint64_t now_ms()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void *loop_main(void *argument)
+{
+    (void)argument;
+
+    pthread_mutex_lock(&loop_lock);
+    for (;;) {
+        arm_event_storage_t *next = NULL;
+        for (int i = 0; i < EVENT_LOOP_STUB_EVENTS; i++) {
+            if (events[i].used && (next == NULL || events[i].due_ms < next->due_ms)) {
+                next = &events[i];
+            }
+        }
+
+        if (next == NULL) {
+            pthread_cond_wait(&loop_changed, &loop_lock);
+            continue;
+        }
+        if (next->due_ms > now_ms()) {
+            struct timespec deadline;
+            deadline.tv_sec = next->due_ms / 1000;
+            deadline.tv_nsec = (next->due_ms % 1000) * 1000000L;
+            pthread_cond_timedwait(&loop_changed, &loop_lock, &deadline);
+            continue;
+        }
+
+        arm_event_t event = next->event;
+        if (next->period_ms > 0) {
+            next->due_ms += next->period_ms;
+        } else {
+            next->used = false;
+        }
+
+        void (*handler)(arm_event_s*) = NULL;
+        if (event.receiver >= 0 && event.receiver < handler_count) {
+            handler = handlers[event.receiver];
+        }
+        pthread_mutex_unlock(&loop_lock);
+        if (handler) {
+            handler(&event);
+        }
+        pthread_mutex_lock(&loop_lock);
+    }
+    return NULL;
+}
+
+static void start_loop()
+{
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&loop_changed, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, loop_main, NULL);
+    pthread_detach(thread);
+    loop_started = true;
+}
+
+static arm_event_storage_t *post(const arm_event_t *event, uint32_t delay_ms, uint32_t period_ms)
+{
+    arm_event_storage_t *storage = NULL;
+
+    pthread_mutex_lock(&loop_lock);
+    for (int i = 0; i < EVENT_LOOP_STUB_EVENTS; i++) {
+        if (!events[i].used) {
+            storage = &events[i];
+            storage->event = *event;
+            storage->due_ms = now_ms() + delay_ms;
+            storage->period_ms = period_ms;
+            storage->used = true;
+            pthread_cond_signal(&loop_changed);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&loop_lock);
+    return storage;
+}
+
+extern "C" {
+
+int8_t eventOS_event_handler_create(void (*handler_func_ptr)(arm_event_s *), uint8_t init_event_type)
+{
+    pthread_mutex_lock(&loop_lock);
+    if (!loop_started) {
+        start_loop();
+    }
+    int8_t id = -1;
+    if (handler_count < EVENT_LOOP_STUB_HANDLERS) {
+        id = handler_count++;
+        handlers[id] = handler_func_ptr;
+    }
+    pthread_mutex_unlock(&loop_lock);
+    if (id < 0) {
+        return -1;
+    }
+
+    arm_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.receiver = id;
+    event.sender = id;
+    event.event_type = init_event_type;
+    event.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+    post(&event, 0, 0);
+    return id;
+}
+
+int8_t eventOS_event_send(const arm_event_t *event)
+{
+    return post(event, 0, 0) ? 0 : -1;
+}
+
+int32_t eventOS_event_timer_ms_to_ticks(uint32_t ms)
+{
+    return (int32_t)ms;
+}
+
+arm_event_storage_t *eventOS_event_send_after(const arm_event_t *event, int32_t ticks)
+{
+    return post(event, (uint32_t)ticks, 0);
+}
+
+arm_event_storage_t *eventOS_event_send_every(const arm_event_t *event, int32_t period)
+{
+    return post(event, (uint32_t)period, (uint32_t)period);
+}
+
+void eventOS_cancel(arm_event_storage_t *event)
+{
+    pthread_mutex_lock(&loop_lock);
+    event->used = false;
+    pthread_mutex_unlock(&loop_lock);
+}
+
+}
@@ -0,0 +1,38 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __FACTORY_CONFIGURATOR_CLIENT_STUB_H__
+#define __FACTORY_CONFIGURATOR_CLIENT_STUB_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int fcc_status_e;
+
+#define FCC_STATUS_SUCCESS 0
+
+fcc_status_e fcc_init(void);
+fcc_status_e fcc_finalize(void);
+fcc_status_e fcc_storage_delete(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FACTORY_CONFIGURATOR_CLIENT_STUB_H__ */
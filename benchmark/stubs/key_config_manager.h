@@ -0,0 +1,26 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __KEY_CONFIG_MANAGER_STUB_H__
+#define __KEY_CONFIG_MANAGER_STUB_H__
+
+typedef enum {
+    KCM_STATUS_SUCCESS = 0
+} kcm_status_e;
+
+#endif /* __KEY_CONFIG_MANAGER_STUB_H__ */
@@ -0,0 +1,250 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "m2m_stub.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint64_t notifications = 0;
+
+String::String() : _value(NULL)
+{
+}
+
+String::String(const char *value) : _value(value ? strdup(value) : NULL)
+{
+}
+
+String::String(const String &other) : _value(other._value ? strdup(other._value) : NULL)
+{
+}
+
+String::~String()
+{
+    free(_value);
+}
+
+String &String::operator=(const String &other)
+{
+    if (this != &other) {
+        free(_value);
+        _value = other._value ? strdup(other._value) : NULL;
+    }
+    return *this;
+}
+
+const char *String::c_str() const
+{
+    return _value ? _value : "";
+}
+
+size_t String::size() const
+{
+    return _value ? strlen(_value) : 0;
+}
+
+M2MReportHandler::M2MReportHandler(M2MBase &base) : _base(base)
+{
+}
+
+void M2MReportHandler::set_notification_trigger(uint16_t obj_instance_id)
+{
+    (void)obj_instance_id;
+    _base.notify();
+}
+
+M2MBase::M2MBase(uint16_t name_id, bool observable) : _name_id(name_id), _operation(NOT_ALLOWED),
+    _observable(observable), _status_cb(NULL), _status_args(NULL), _report_handler(*this)
+{
+}
+
+M2MBase::~M2MBase()
+{
+}
+
+uint16_t M2MBase::name_id() const
+{
+    return _name_id;
+}
+
+void M2MBase::set_operation(Operation operation)
+{
+    _operation = operation;
+}
+
+M2MBase::Operation M2MBase::operation() const
+{
+    return (Operation)_operation;
+}
+
+bool M2MBase::is_observable() const
+{
+    return _observable;
+}
+
+void M2MBase::set_notification_delivery_status_cb(notification_delivery_status_cb cb, void *client_args)
+{
+    _status_cb = cb;
+    _status_args = client_args;
+}
+
+M2MReportHandler *M2MBase::report_handler() const
+{
+    return &_report_handler;
+}
+
+uint64_t M2MBase::notification_count()
+{
+    return __atomic_load_n(&notifications, __ATOMIC_RELAXED);
+}
+
+void M2MBase::notify()
+{
+    if (!_observable) {
+        return;
+    }
+    __atomic_fetch_add(&notifications, 1, __ATOMIC_RELAXED);
+    if (_status_cb) {
+        _status_cb(*this, NOTIFICATION_STATUS_SENT, _status_args);
+        _status_cb(*this, NOTIFICATION_STATUS_DELIVERED, _status_args);
+    }
+}
+
+M2MResourceInstance::M2MResourceInstance(uint16_t name_id, ResourceType type, bool observable) :
+    M2MBase(name_id, observable), _type(type)
+{
+}
+
+bool M2MResourceInstance::set_value(const uint8_t *value, const uint32_t length)
+{
+    bool changed = length != _value.size() || (length > 0 && memcmp(&_value[0], value, length) != 0);
+    _value.assign(value, value + length);
+    if (changed) {
+        notify();
+    }
+    return true;
+}
+
+bool M2MResourceInstance::set_value(int64_t value)
+{
+    // The client keeps integers as text too.
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%lld", (long long)value);
+    return set_value((const uint8_t*)text, (uint32_t)length);
+}
+
+int64_t M2MResourceInstance::get_value_int() const
+{
+    char text[24];
+    size_t length = (_value.size() < sizeof(text)) ? _value.size() : sizeof(text) - 1;
+    if (length > 0) {
+        memcpy(text, &_value[0], length);
+    }
+    text[length] = '\0';
+    return strtoll(text, NULL, 10);
+}
+
+uint8_t *M2MResourceInstance::value() const
+{
+    return _value.empty() ? NULL : (uint8_t*)&_value[0];
+}
+
+uint32_t M2MResourceInstance::value_length() const
+{
+    return (uint32_t)_value.size();
+}
+
+void M2MResourceInstance::set_value_updated_function(void (*callback)(const char*))
+{
+    (void)callback;
+}
+
+void M2MResourceInstance::set_execute_function(void (*callback)(void*))
+{
+    (void)callback;
+}
+
+M2MResource::M2MResource(uint16_t name_id, ResourceType type, bool observable) :
+    M2MResourceInstance(name_id, type, observable)
+{
+}
+
+M2MObjectInstance::M2MObjectInstance(uint16_t name_id) : M2MBase(name_id, false)
+{
+}
+
+M2MObjectInstance::~M2MObjectInstance()
+{
+    for (size_t i = 0; i < _resources.size(); i++) {
+        delete _resources[i];
+    }
+}
+
+M2MResource *M2MObjectInstance::create_dynamic_resource(const char *name, const char *resource_type,
+                                                        M2MResourceInstance::ResourceType type, bool observable)
+{
+    (void)resource_type;
+    M2MResource *resource = new M2MResource((uint16_t)atoi(name), type, observable);
+    _resources.push_back(resource);
+    return resource;
+}
+
+M2MResource *M2MObjectInstance::resource(uint16_t name_id) const
+{
+    for (size_t i = 0; i < _resources.size(); i++) {
+        if (_resources[i]->name_id() == name_id) {
+            return _resources[i];
+        }
+    }
+    return NULL;
+}
+
+M2MObject::M2MObject(uint16_t name_id) : M2MBase(name_id, false)
+{
+}
+
+M2MObject::~M2MObject()
+{
+    for (size_t i = 0; i < _instances.size(); i++) {
+        delete _instances[i];
+    }
+}
+
+M2MObjectInstance *M2MObject::create_object_instance(uint16_t instance_id)
+{
+    M2MObjectInstance *instance = new M2MObjectInstance(instance_id);
+    _instances.push_back(instance);
+    return instance;
+}
+
+M2MObjectInstance *M2MObject::object_instance(uint16_t instance_id) const
+{
+    // Searched from the end, as instances are mostly created in order.
+    for (size_t i = _instances.size(); i > 0; i--) {
+        if (_instances[i - 1]->name_id() == instance_id) {
+            return _instances[i - 1];
+        }
+    }
+    return NULL;
+}
+
+M2MObject *M2MInterfaceFactory::create_object(const char *name)
+{
+    return new M2MObject((uint16_t)atoi(name));
+}
@@ -0,0 +1,203 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __M2M_STUB_H__
+#define __M2M_STUB_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * In-process stand-in for the mbed Client object model, limited to what
+ * the application uses. A value change of an observable resource counts
+ * as one notification and is reported as delivered right away. Values are
+ * kept in buffers which only grow, so once every resource has held its
+ * largest value the stub no longer allocates.
+ */
+
+typedef enum {
+    NOTIFICATION_STATUS_INIT = 0,
+    NOTIFICATION_STATUS_BUILD_ERROR,
+    NOTIFICATION_STATUS_RESEND_QUEUE_FULL,
+    NOTIFICATION_STATUS_SENT,
+    NOTIFICATION_STATUS_DELIVERED,
+    NOTIFICATION_STATUS_SEND_FAILED,
+    NOTIFICATION_STATUS_SUBSCRIBED,
+    NOTIFICATION_STATUS_UNSUBSCRIBED
+} NoticationDeliveryStatus;
+
+class String
+{
+public:
+    String();
+    String(const char *value);
+    String(const String &other);
+    ~String();
+    String &operator=(const String &other);
+
+    const char *c_str() const;
+    size_t size() const;
+
+private:
+    char    *_value;
+};
+
+namespace m2m {
+template <typename T>
+class Vector : public std::vector<T>
+{
+};
+}
+
+class M2MBase;
+
+class M2MReportHandler
+{
+public:
+    explicit M2MReportHandler(M2MBase &base);
+
+    /**
+     * \brief Notifies the current value again.
+     */
+    void set_notification_trigger(uint16_t obj_instance_id = 0);
+
+private:
+    M2MBase &_base;
+};
+
+class M2MBase
+{
+    friend class M2MReportHandler;
+
+public:
+    typedef enum {
+        NOT_ALLOWED                 = 0x00,
+        GET_ALLOWED                 = 0x01,
+        PUT_ALLOWED                 = 0x02,
+        GET_PUT_ALLOWED             = 0x03,
+        POST_ALLOWED                = 0x04,
+        GET_POST_ALLOWED            = 0x05,
+        PUT_POST_ALLOWED            = 0x06,
+        GET_PUT_POST_ALLOWED        = 0x07,
+        DELETE_ALLOWED              = 0x08
+    } Operation;
+
+    typedef void (*notification_delivery_status_cb)(const M2MBase &base,
+                                                    const NoticationDeliveryStatus status,
+                                                    void *client_args);
+
+    M2MBase(uint16_t name_id, bool observable);
+    virtual ~M2MBase();
+
+    uint16_t name_id() const;
+    void set_operation(Operation operation);
+    Operation operation() const;
+    bool is_observable() const;
+    void set_notification_delivery_status_cb(notification_delivery_status_cb cb, void *client_args);
+    M2MReportHandler *report_handler() const;
+
+    /**
+     * \brief Total number of notifications of all resources.
+     */
+    static uint64_t notification_count();
+
+protected:
+    void notify();
+
+private:
+    uint16_t    _name_id;
+    uint8_t     _operation;
+    bool        _observable;
+    notification_delivery_status_cb _status_cb;
+    void        *_status_args;
+    mutable M2MReportHandler _report_handler;
+};
+
+class M2MResourceInstance : public M2MBase
+{
+public:
+    typedef enum {
+        STRING,
+        INTEGER,
+        FLOAT,
+        BOOLEAN,
+        OPAQUE,
+        TIME,
+        OBJLINK
+    } ResourceType;
+
+    M2MResourceInstance(uint16_t name_id, ResourceType type, bool observable);
+
+    bool set_value(const uint8_t *value, const uint32_t length);
+    bool set_value(int64_t value);
+    int64_t get_value_int() const;
+    uint8_t *value() const;
+    uint32_t value_length() const;
+
+    void set_value_updated_function(void (*callback)(const char*));
+    void set_execute_function(void (*callback)(void*));
+
+private:
+    std::vector<uint8_t> _value;
+    ResourceType _type;
+};
+
+class M2MResource : public M2MResourceInstance
+{
+public:
+    M2MResource(uint16_t name_id, ResourceType type, bool observable);
+};
+
+class M2MObjectInstance : public M2MBase
+{
+public:
+    explicit M2MObjectInstance(uint16_t name_id);
+    ~M2MObjectInstance();
+
+    M2MResource *create_dynamic_resource(const char *name, const char *resource_type,
+                                         M2MResourceInstance::ResourceType type, bool observable);
+    M2MResource *resource(uint16_t name_id) const;
+
+private:
+    std::vector<M2MResource*> _resources;
+};
+
+class M2MObject : public M2MBase
+{
+public:
+    explicit M2MObject(uint16_t name_id);
+    ~M2MObject();
+
+    M2MObjectInstance *create_object_instance(uint16_t instance_id = 0);
+    M2MObjectInstance *object_instance(uint16_t instance_id = 0) const;
+
+private:
+    std::vector<M2MObjectInstance*> _instances;
+};
+
+typedef m2m::Vector<M2MObject*> M2MObjectList;
+
+class M2MInterfaceFactory
+{
+public:
+    static M2MObject *create_object(const char *name);
+};
+
+#endif /* __M2M_STUB_H__ */
@@ -0,0 +1,24 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __STUB_MBED_CLIENT_M2MREPORTHANDLER_H__
+#define __STUB_MBED_CLIENT_M2MREPORTHANDLER_H__
+
+#include "m2m_stub.h"
+
+#endif /* __STUB_MBED_CLIENT_M2MREPORTHANDLER_H__ */
@@ -0,0 +1,155 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __MBED_CLOUD_CLIENT_STUB_H__
+#define __MBED_CLOUD_CLIENT_STUB_H__
+
+#include "m2m_stub.h"
+
+#include <string.h>
+
+struct ConnectorClientEndpointInfo {
+    String endpoint_name;
+    String internal_endpoint_name;
+};
+
+/**
+ * \brief Member function callback, enough of mbed's FP for the stub.
+ */
+class StubCallback
+{
+public:
+    StubCallback() : _object(NULL), _thunk(NULL)
+    {
+    }
+
+    template <typename T>
+    void attach(T *object, void (T::*member)(void))
+    {
+        store(object, &member, sizeof(member));
+        _thunk = &StubCallback::call_void<T>;
+    }
+
+    template <typename T>
+    void attach(T *object, void (T::*member)(int))
+    {
+        store(object, &member, sizeof(member));
+        _thunk = &StubCallback::call_int<T>;
+    }
+
+    void call(int argument = 0) const
+    {
+        if (_thunk) {
+            _thunk(_object, _member, argument);
+        }
+    }
+
+private:
+    void store(void *object, const void *member, size_t size)
+    {
+        // Member function pointers are two words with GCC and Clang.
+        memcpy(_member, member, (size < sizeof(_member)) ? size : sizeof(_member));
+        _object = object;
+    }
+
+    template <typename T>
+    static void call_void(void *object, const char *member, int)
+    {
+        void (T::*method)(void);
+        memcpy(&method, member, sizeof(method));
+        (static_cast<T*>(object)->*method)();
+    }
+
+    template <typename T>
+    static void call_int(void *object, const char *member, int argument)
+    {
+        void (T::*method)(int);
+        memcpy(&method, member, sizeof(method));
+        (static_cast<T*>(object)->*method)(argument);
+    }
+
+private:
+    void    *_object;
+    void    (*_thunk)(void *object, const char *member, int argument);
+    char    _member[2 * sizeof(void*)];
+};
+
+/**
+ * \brief In-process stand-in for MbedCloudClient. setup() registers at
+ *        once and close() unregisters, nothing leaves the process.
+ *        set_registered() and report_error() let a benchmark drive the
+ *        connection state.
+ */
+class MbedCloudClient
+{
+public:
+    typedef enum {
+        ConnectErrorNone                        = 0x0,
+        ConnectAlreadyExists,
+        ConnectBootstrapFailed,
+        ConnectInvalidParameters,
+        ConnectNotRegistered,
+        ConnectTimeout,
+        ConnectNetworkError,
+        ConnectResponseParseFailed,
+        ConnectUnknownError,
+        ConnectMemoryConnectFail,
+        ConnectNotAllowed,
+        ConnectSecureConnectionFailed,
+        ConnectDnsResolvingFailed
+    } Error;
+
+    MbedCloudClient();
+
+    template <typename T>
+    void on_registered(T *object, void (T::*member)(void))
+    {
+        _on_registered.attach(object, member);
+    }
+
+    template <typename T>
+    void on_unregistered(T *object, void (T::*member)(void))
+    {
+        _on_unregistered.attach(object, member);
+    }
+
+    template <typename T>
+    void on_error(T *object, void (T::*member)(int))
+    {
+        _on_error.attach(object, member);
+    }
+
+    void add_objects(const M2MObjectList &object_list);
+    bool setup(void *iface);
+    void close();
+    void register_update();
+    const ConnectorClientEndpointInfo *endpoint_info() const;
+    const char *error_description() const;
+
+    void set_registered(bool registered);
+    void report_error(Error error);
+
+private:
+    StubCallback _on_registered;
+    StubCallback _on_unregistered;
+    StubCallback _on_error;
+    ConnectorClientEndpointInfo _endpoint;
+    const M2MObjectList *_objects;
+};
+
+#endif /* __MBED_CLOUD_CLIENT_STUB_H__ */
@@ -0,0 +1,60 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __EVENTOS_EVENT_STUB_H__
+#define __EVENTOS_EVENT_STUB_H__
+
+/*
+ * The event loop API used by the application, run on one thread by
+ * event_loop_stub.cpp. Timer ticks are milliseconds.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum arm_library_event_priority_e {
+    ARM_LIB_HIGH_PRIORITY_EVENT = 0,
+    ARM_LIB_MED_PRIORITY_EVENT = 1,
+    ARM_LIB_LOW_PRIORITY_EVENT = 2
+} arm_library_event_priority_e;
+
+typedef struct arm_event_s {
+    int8_t receiver;
+    int8_t sender;
+    uint8_t event_type;
+    uint8_t event_id;
+    uint32_t event_data;
+    void *data_ptr;
+    arm_library_event_priority_e priority;
+} arm_event_s;
+
+typedef struct arm_event_s arm_event_t;
+typedef struct arm_event_storage arm_event_storage_t;
+
+int8_t eventOS_event_handler_create(void (*handler_func_ptr)(arm_event_s *), uint8_t init_event_type);
+int8_t eventOS_event_send(const arm_event_t *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENTOS_EVENT_STUB_H__ */
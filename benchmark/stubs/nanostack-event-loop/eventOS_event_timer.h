@@ -0,0 +1,37 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __EVENTOS_EVENT_TIMER_STUB_H__
+#define __EVENTOS_EVENT_TIMER_STUB_H__
+
+#include "eventOS_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int32_t eventOS_event_timer_ms_to_ticks(uint32_t ms);
+arm_event_storage_t *eventOS_event_send_after(const arm_event_t *event, int32_t ticks);
+arm_event_storage_t *eventOS_event_send_every(const arm_event_t *event, int32_t period);
+void eventOS_cancel(arm_event_storage_t *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENTOS_EVENT_TIMER_STUB_H__ */
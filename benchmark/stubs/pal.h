@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __PAL_STUB_H__
+#define __PAL_STUB_H__
+
+/*
+ * The part of the PAL API used by the application, implemented on POSIX
+ * by pal_stub.cpp. Files go to the directory in PAL_STUB_MOUNT_POINT.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef PAL_STUB_MOUNT_POINT
+#define PAL_STUB_MOUNT_POINT "."
+#endif
+
+typedef int32_t palStatus_t;
+
+#define PAL_SUCCESS                     0
+#define PAL_ERR_GENERIC_FAILURE         (-1)
+#define PAL_ERR_FS_NO_FILE              (-2)
+#define PAL_ERR_RTOS_TIMEOUT            (-3)
+#define PAL_ERR_NO_MEMORY               (-4)
+
+#define PAL_MAX_FILE_AND_FOLDER_LENGTH  256
+#define PAL_RTOS_WAIT_FOREVER           0xFFFFFFFF
+
+typedef uintptr_t palFileDescriptor_t;
+typedef uintptr_t palThreadID_t;
+typedef uintptr_t palMutexID_t;
+typedef uintptr_t palSemaphoreID_t;
+typedef struct palThreadLocalStore palThreadLocalStore_t;
+typedef void (*palThreadFuncPtr)(void const *argument);
+
+typedef enum {
+    PAL_osPriorityIdle = -3,
+    PAL_osPriorityLow = -2,
+    PAL_osPriorityBelowNormal = -1,
+    PAL_osPriorityNormal = 0,
+    PAL_osPriorityAboveNormal = 1,
+    PAL_osPriorityHigh = 2,
+    PAL_osPriorityRealtime = 3
+} palThreadPriority_t;
+
+typedef enum {
+    PAL_FS_FLAG_READONLY = 1,
+    PAL_FS_FLAG_READWRITEEXCLUSIVE,
+    PAL_FS_FLAG_READWRITE,
+    PAL_FS_FLAG_READWRITETRUNC
+} pal_fsFileMode_t;
+
+typedef enum {
+    PAL_FS_OFFSET_SEEKSET = 0,
+    PAL_FS_OFFSET_SEEKCUR,
+    PAL_FS_OFFSET_SEEKEND
+} pal_fsOffset_t;
+
+typedef enum {
+    PAL_FS_PARTITION_PRIMARY = 0,
+    PAL_FS_PARTITION_SECONDARY
+} pal_fsStorageID_t;
+
+uint64_t pal_osKernelSysTick(void);
+uint64_t pal_osKernelSysTickMicroSec(uint64_t microseconds);
+uint64_t pal_osKernelSysMilliSecTick(uint64_t sysTicks);
+uint64_t pal_osKernelSysTickFrequency(void);
+palStatus_t pal_osDelay(uint32_t milliseconds);
+
+palStatus_t pal_osThreadCreateWithAlloc(palThreadFuncPtr function, void *funcArgument,
+                                        palThreadPriority_t priority, uint32_t stackSize,
+                                        palThreadLocalStore_t *store, palThreadID_t *threadID);
+palStatus_t pal_osThreadTerminate(palThreadID_t *threadID);
+
+palStatus_t pal_osMutexCreate(palMutexID_t *mutexID);
+palStatus_t pal_osMutexWait(palMutexID_t mutexID, uint32_t millisec);
+palStatus_t pal_osMutexRelease(palMutexID_t mutexID);
+palStatus_t pal_osMutexDelete(palMutexID_t *mutexID);
+
+palStatus_t pal_osSemaphoreCreate(uint32_t count, palSemaphoreID_t *semaphoreID);
+palStatus_t pal_osSemaphoreWait(palSemaphoreID_t semaphoreID, uint32_t millisec, int32_t *countersAvailable);
+palStatus_t pal_osSemaphoreRelease(palSemaphoreID_t semaphoreID);
+palStatus_t pal_osSemaphoreDelete(palSemaphoreID_t *semaphoreID);
+
+palStatus_t pal_fsFopen(const char *pathName, pal_fsFileMode_t mode, palFileDescriptor_t *fd);
+palStatus_t pal_fsFclose(palFileDescriptor_t *fd);
+palStatus_t pal_fsFread(palFileDescriptor_t *fd, void *buffer, size_t numOfBytes, size_t *numberOfBytesRead);
+palStatus_t pal_fsFwrite(palFileDescriptor_t *fd, const void *buffer, size_t numOfBytes, size_t *numberOfBytesWritten);
+palStatus_t pal_fsFseek(palFileDescriptor_t *fd, int32_t offset, pal_fsOffset_t whence);
+palStatus_t pal_fsFtell(palFileDescriptor_t *fd, int32_t *pos);
+palStatus_t pal_fsUnlink(const char *pathName);
+palStatus_t pal_fsGetMountPoint(pal_fsStorageID_t dataID, size_t length, char *mountPoint);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PAL_STUB_H__ */
@@ -0,0 +1,311 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "pal.h"
+#include "common_setup.h"
+#include "factory_configurator_client.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct ThreadStart {
+    palThreadFuncPtr    function;
+    void                *argument;
+};
+
+static void *thread_main(void *argument)
+{
+    ThreadStart start = *(ThreadStart*)argument;
+    delete (ThreadStart*)argument;
+    start.function(start.argument);
+    return NULL;
+}
+
+static void sleep_ms(uint32_t milliseconds)
+{
+    struct timespec wait;
+    wait.tv_sec = milliseconds / 1000;
+    wait.tv_nsec = (milliseconds % 1000) * 1000000L;
+    while (nanosleep(&wait, &wait) != 0 && errno == EINTR) {
+    }
+}
+
+extern "C" {
+
+uint64_t pal_osKernelSysTick(void)
+{
+    // Microsecond ticks.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+uint64_t pal_osKernelSysTickMicroSec(uint64_t microseconds)
+{
+    return microseconds;
+}
+
+uint64_t pal_osKernelSysMilliSecTick(uint64_t sysTicks)
+{
+    return sysTicks / 1000;
+}
+
+uint64_t pal_osKernelSysTickFrequency(void)
+{
+    return 1000000;
+}
+
+palStatus_t pal_osDelay(uint32_t milliseconds)
+{
+    sleep_ms(milliseconds);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osThreadCreateWithAlloc(palThreadFuncPtr function, void *funcArgument,
+                                        palThreadPriority_t priority, uint32_t stackSize,
+                                        palThreadLocalStore_t *store, palThreadID_t *threadID)
+{
+    (void)priority;
+    (void)store;
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    if (stackSize < PTHREAD_STACK_MIN) {
+        stackSize = PTHREAD_STACK_MIN;
+    }
+    pthread_attr_setstacksize(&attributes, stackSize);
+
+    ThreadStart *start = new ThreadStart;
+    start->function = function;
+    start->argument = funcArgument;
+
+    pthread_t thread;
+    int result = pthread_create(&thread, &attributes, thread_main, start);
+    pthread_attr_destroy(&attributes);
+    if (result != 0) {
+        delete start;
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    *threadID = (palThreadID_t)thread;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osThreadTerminate(palThreadID_t *threadID)
+{
+    // Only called for threads which returned already.
+    pthread_join((pthread_t)*threadID, NULL);
+    *threadID = 0;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osMutexCreate(palMutexID_t *mutexID)
+{
+    pthread_mutex_t *mutex = new pthread_mutex_t;
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    *mutexID = (palMutexID_t)mutex;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osMutexWait(palMutexID_t mutexID, uint32_t millisec)
+{
+    (void)millisec;
+    pthread_mutex_lock((pthread_mutex_t*)mutexID);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osMutexRelease(palMutexID_t mutexID)
+{
+    pthread_mutex_unlock((pthread_mutex_t*)mutexID);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osMutexDelete(palMutexID_t *mutexID)
+{
+    pthread_mutex_t *mutex = (pthread_mutex_t*)*mutexID;
+    pthread_mutex_destroy(mutex);
+    delete mutex;
+    *mutexID = 0;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osSemaphoreCreate(uint32_t count, palSemaphoreID_t *semaphoreID)
+{
+    sem_t *semaphore = new sem_t;
+    sem_init(semaphore, 0, count);
+    *semaphoreID = (palSemaphoreID_t)semaphore;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osSemaphoreWait(palSemaphoreID_t semaphoreID, uint32_t millisec, int32_t *countersAvailable)
+{
+    sem_t *semaphore = (sem_t*)semaphoreID;
+    int result;
+    if (millisec == PAL_RTOS_WAIT_FOREVER) {
+        while ((result = sem_wait(semaphore)) != 0 && errno == EINTR) {
+        }
+    } else {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += millisec / 1000;
+        deadline.tv_nsec += (millisec % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while ((result = sem_timedwait(semaphore, &deadline)) != 0 && errno == EINTR) {
+        }
+    }
+
+    if (countersAvailable) {
+        int value = 0;
+        sem_getvalue(semaphore, &value);
+        *countersAvailable = value;
+    }
+    return (result == 0) ? PAL_SUCCESS : PAL_ERR_RTOS_TIMEOUT;
+}
+
+palStatus_t pal_osSemaphoreRelease(palSemaphoreID_t semaphoreID)
+{
+    sem_post((sem_t*)semaphoreID);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_osSemaphoreDelete(palSemaphoreID_t *semaphoreID)
+{
+    sem_t *semaphore = (sem_t*)*semaphoreID;
+    sem_destroy(semaphore);
+    delete semaphore;
+    *semaphoreID = 0;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_fsFopen(const char *pathName, pal_fsFileMode_t mode, palFileDescriptor_t *fd)
+{
+    const char *flags;
+    switch (mode) {
+        case PAL_FS_FLAG_READONLY:
+            flags = "rb";
+            break;
+        case PAL_FS_FLAG_READWRITEEXCLUSIVE:
+            flags = "wxb+";
+            break;
+        case PAL_FS_FLAG_READWRITETRUNC:
+            flags = "w+b";
+            break;
+        default:
+            flags = "r+b";
+            break;
+    }
+
+    FILE *file = fopen(pathName, flags);
+    if (file == NULL) {
+        return PAL_ERR_FS_NO_FILE;
+    }
+    *fd = (palFileDescriptor_t)file;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_fsFclose(palFileDescriptor_t *fd)
+{
+    int result = fclose((FILE*)*fd);
+    *fd = 0;
+    return (result == 0) ? PAL_SUCCESS : PAL_ERR_GENERIC_FAILURE;
+}
+
+palStatus_t pal_fsFread(palFileDescriptor_t *fd, void *buffer, size_t numOfBytes, size_t *numberOfBytesRead)
+{
+    *numberOfBytesRead = fread(buffer, 1, numOfBytes, (FILE*)*fd);
+    return ferror((FILE*)*fd) ? PAL_ERR_GENERIC_FAILURE : PAL_SUCCESS;
+}
+
+palStatus_t pal_fsFwrite(palFileDescriptor_t *fd, const void *buffer, size_t numOfBytes, size_t *numberOfBytesWritten)
+{
+    // PAL writes through, so flush like it.
+    *numberOfBytesWritten = fwrite(buffer, 1, numOfBytes, (FILE*)*fd);
+    return (fflush((FILE*)*fd) == 0) ? PAL_SUCCESS : PAL_ERR_GENERIC_FAILURE;
+}
+
+palStatus_t pal_fsFseek(palFileDescriptor_t *fd, int32_t offset, pal_fsOffset_t whence)
+{
+    int origin = (whence == PAL_FS_OFFSET_SEEKSET) ? SEEK_SET :
+                 (whence == PAL_FS_OFFSET_SEEKCUR) ? SEEK_CUR : SEEK_END;
+    return (fseek((FILE*)*fd, offset, origin) == 0) ? PAL_SUCCESS : PAL_ERR_GENERIC_FAILURE;
+}
+
+palStatus_t pal_fsFtell(palFileDescriptor_t *fd, int32_t *pos)
+{
+    *pos = (int32_t)ftell((FILE*)*fd);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_fsUnlink(const char *pathName)
+{
+    return (unlink(pathName) == 0) ? PAL_SUCCESS : PAL_ERR_FS_NO_FILE;
+}
+
+palStatus_t pal_fsGetMountPoint(pal_fsStorageID_t dataID, size_t length, char *mountPoint)
+{
+    (void)dataID;
+    int written = snprintf(mountPoint, length, "%s", PAL_STUB_MOUNT_POINT);
+    return (written >= 0 && (size_t)written < length) ? PAL_SUCCESS : PAL_ERR_GENERIC_FAILURE;
+}
+
+// The platform and factory configurator calls made by the linked sources.
+
+int mcc_platform_init_connection(void)
+{
+    return 0;
+}
+
+void *mcc_platform_get_network_interface(void)
+{
+    static int network_interface;
+    return &network_interface;
+}
+
+void mcc_platform_do_wait(int timeout_ms)
+{
+    sleep_ms((uint32_t)timeout_ms);
+}
+
+fcc_status_e fcc_init(void)
+{
+    return FCC_STATUS_SUCCESS;
+}
+
+fcc_status_e fcc_finalize(void)
+{
+    return FCC_STATUS_SUCCESS;
+}
+
+fcc_status_e fcc_storage_delete(void)
+{
+    return FCC_STATUS_SUCCESS;
+}
+
+}
@@ -23,14 +23,11 @@
 #include "application_init.h"
 #include "common_button_and_led.h"
 #include "blinky.h"
+#include "shelf_engine.h"
+
+// Time between two reports while waiting for the first registration.
+#define REGISTRATION_REPORT_INTERVAL_MS 30000
 
-const char* product_strings[] = {
-    "Apples",
-    "Cheese",
-    "Milk",
-    "Bread",
-    "Beer"
-};
 static void main_application(void);
 
 int main(void)
@@ -38,11 +35,6 @@ int main(void)
     mcc_platform_run_program(main_application);
 }
 
-// Pointers to the resources that will be created in main_application().
-static M2MResource* product_id;
-static M2MResource* product_current_count;
-static M2MResource* product_empty;
-
 // Pointer to mbedClient, used for calling close function.
 static SimpleM2MClient *client;
 
@@ -149,18 +141,17 @@ void main_application(void)
     print_stack_statistics();
 #endif
 
-//    static M2MResource* product_id;
-//    static M2MResource* product_current_count;
-//    static M2MResource* product_empty;
-
-    product_id = mbedClient.add_cloud_resource(10341, 0, 26341, "product_id", M2MResourceInstance::STRING,
-                              M2MBase::GET_ALLOWED, 0, false, NULL, NULL);
-
-    product_current_count = mbedClient.add_cloud_resource(10341, 0, 26342, "product_current_count", M2MResourceInstance::INTEGER,
-                              M2MBase::GET_ALLOWED, 0, true, NULL, NULL);
+    // Create the shelves. Paths of the resources of shelf n will be 10341/n/26341-26348.
+    ShelfEngine shelves;
+    if (!shelves.create_shelves(mbedClient, SHELF_ENGINE_SHELF_COUNT)) {
+        printf("Failed to create shelves, exiting application!\n");
+        return;
+    }
+    shelves.print_memory_stats();
 
-    product_empty = mbedClient.add_cloud_resource(10341, 0, 26343, "product_empty", M2MResourceInstance::INTEGER,
-                              M2MBase::GET_ALLOWED, 0, true, NULL, NULL);
+    // Resume from the state persisted before the last restart, if any, so
+    // the first registration already carries the real values.
+    shelves.restore();
 
     // Create resource for unregistering the device. Path of this resource will be: 5000/0/1.
     mbedClient.add_cloud_resource(5000, 0, 1, "unregister", M2MResourceInstance::STRING,
@@ -170,45 +161,28 @@ void main_application(void)
     mbedClient.add_cloud_resource(5000, 0, 2, "factory_reset", M2MResourceInstance::STRING,
                  M2MBase::POST_ALLOWED, NULL, false, (void*)factory_reset, NULL);
 
-    mbedClient.register_and_connect();
-    while(!mbedClient.is_client_registered()){
-        mcc_platform_do_wait(1000);
+    // Create the connection quality resources. Paths of these resources will be: 5000/0/5-13.
+    ConnectionMetrics metrics;
+    if (!metrics.create_resources(mbedClient)) {
+        printf("Failed to create connection metrics, exiting application!\n");
+        return;
     }
-    printf("Setting srand %d\n\r", mbedClient.get_unique_id());
-
-    srand(mbedClient.get_unique_id());
-    unsigned int max_cnt = ((rand() % 3) + 1) * 10; //10, 20, 30 possible in stock on this row
-    int sale_prob = rand();
 
-    // Set a product ID
-    const char* product_string = product_strings[rand() % 5];
-    product_id->set_value((const uint8_t*)product_string, strlen(product_string)); // 5 possible products
-    product_current_count->set_value(max_cnt);
+    mbedClient.register_and_connect();
+    while(!mbedClient.wait_for_registration(REGISTRATION_REPORT_INTERVAL_MS)){
+        if (!mbedClient.is_register_called()) {
+            printf("Registration failed, exiting application!\n");
+            return;
+        }
+        printf("Still waiting for the registration\n");
+    }
+    printf("Setting simulation seed %016llx\n\r", (unsigned long long)mbedClient.get_unique_id());
+    shelves.start(mbedClient.get_unique_id());
+    metrics.start();
 
     printf("Starting simulation\n\r");
 
-    // Check if client is registering or registered, if true sleep and repeat.
-    while (mbedClient.is_register_called()) {
-        int cnt_down = (rand() % 9900) + 100; // Random wait between 100 ms and 10s
-        mcc_platform_do_wait(cnt_down);
-
-        if (product_empty->get_value_int() == 1) {
-            mcc_platform_do_wait(10000);
-            product_current_count->set_value(max_cnt); // Restock
-            product_empty->set_value(0);
-        }
-        product_current_count->set_value(product_current_count->get_value_int() - 1);
-        //Sold
-        if(rand() < sale_prob){}
-        else{
-            mcc_platform_do_wait(1000);
-            product_current_count->set_value(product_current_count->get_value_int() + 1);
-        }
-
-        if(product_current_count->get_value_int() == 0){
-            product_empty->set_value(1);
-        }
-    }
+    shelves.run(mbedClient);
 
     // Client unregistered, exit program.
 }
@@ -0,0 +1,234 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "connection_metrics.h"
+#include "simplem2mclient.h"
+#include "spsc_queue.h"
+#include "pal.h"
+
+#include "nanostack-event-loop/eventOS_event_timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CONNECTION_METRICS_TASKLET_INIT_EVENT   0
+#define CONNECTION_METRICS_TASKLET_TIMER        10
+
+ConnectionMetrics *ConnectionMetrics::_instance = NULL;
+int8_t ConnectionMetrics::_tasklet = -1;
+
+static const char *const metric_names[CONNECTION_METRIC_COUNT] = {
+    "notifications_sent",
+    "notifications_delivered",
+    "notifications_failed",
+    "rtt_ms",
+    "since_delivery_s",
+    "reconnect_attempts",
+    "disconnected_s",
+    "registration_updates",
+    "notifications_resent"
+};
+
+static uint32_t now_ms()
+{
+    return (uint32_t)pal_osKernelSysMilliSecTick(pal_osKernelSysTick());
+}
+
+// Status callback of the metric resources, so that their own notifications
+// are not counted as application traffic.
+static void ignore_status(const M2MBase &base, const NoticationDeliveryStatus status, void *client_args)
+{
+    (void)base;
+    (void)status;
+    (void)client_args;
+}
+
+extern "C" {
+
+static void metrics_event_handler_wrapper(arm_event_s *event)
+{
+    if (event->event_type != CONNECTION_METRICS_TASKLET_INIT_EVENT) {
+        ConnectionMetrics *instance = (ConnectionMetrics *)event->data_ptr;
+        instance->event_handler(*event);
+    }
+}
+
+}
+
+ConnectionMetrics::ConnectionMetrics() : _client(NULL), _sent(0), _delivered(0), _failed(0), _resent(0),
+    _srtt_ms8(0),
+    _last_delivery_ms(0), _timer(NULL)
+{
+    memset(_resources, 0, sizeof(_resources));
+    memset(_pending, 0, sizeof(_pending));
+}
+
+ConnectionMetrics::~ConnectionMetrics()
+{
+    if (_timer != NULL) {
+        eventOS_cancel(_timer);
+    }
+    if (_instance == this) {
+        _instance = NULL;
+    }
+}
+
+bool ConnectionMetrics::create_resources(SimpleM2MClient &client)
+{
+    _client = &client;
+    _instance = this;
+    _last_delivery_ms = now_ms();
+
+    for (int i = 0; i < CONNECTION_METRIC_COUNT; i++) {
+        _resources[i] = client.add_cloud_resource(CONNECTION_METRICS_OBJECT_ID, 0,
+                                                  CONNECTION_METRICS_FIRST_RESOURCE_ID + i,
+                                                  metric_names[i], M2MResourceInstance::INTEGER,
+                                                  M2MBase::GET_ALLOWED, "0", true, NULL,
+                                                  (void*)ignore_status);
+        if (_resources[i] == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ConnectionMetrics::start()
+{
+    if (_tasklet < 0) {
+        _tasklet = eventOS_event_handler_create(metrics_event_handler_wrapper, CONNECTION_METRICS_TASKLET_INIT_EVENT);
+        if (_tasklet < 0) {
+            return false;
+        }
+    }
+    if (_timer != NULL) {
+        return true;
+    }
+
+    arm_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.event_type = CONNECTION_METRICS_TASKLET_TIMER;
+    event.receiver = _tasklet;
+    event.sender = _tasklet;
+    event.data_ptr = this;
+    event.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+    _timer = eventOS_event_send_every(&event, eventOS_event_timer_ms_to_ticks(CONNECTION_METRICS_PERIOD_MS));
+    return _timer != NULL;
+}
+
+uint32_t ConnectionMetrics::value(ConnectionMetric metric) const
+{
+    switch (metric) {
+        case CONNECTION_METRIC_SENT:
+            return SPSC_LOAD_ACQUIRE(&_sent);
+        case CONNECTION_METRIC_DELIVERED:
+            return SPSC_LOAD_ACQUIRE(&_delivered);
+        case CONNECTION_METRIC_FAILED:
+            return SPSC_LOAD_ACQUIRE(&_failed);
+        case CONNECTION_METRIC_RTT:
+            return SPSC_LOAD_ACQUIRE(&_srtt_ms8) / 8;
+        case CONNECTION_METRIC_SINCE_DELIVERY:
+            return (now_ms() - SPSC_LOAD_ACQUIRE(&_last_delivery_ms)) / 1000;
+        case CONNECTION_METRIC_RECONNECTS:
+            return _client ? _client->get_reconnect_controller().attempts() : 0;
+        case CONNECTION_METRIC_DISCONNECTED:
+            return _client ? (uint32_t)(_client->get_reconnect_controller().disconnected_ms() / 1000) : 0;
+        case CONNECTION_METRIC_REG_UPDATES:
+            return _client ? _client->get_registration_scheduler().updates() : 0;
+        case CONNECTION_METRIC_RESENT:
+            return SPSC_LOAD_ACQUIRE(&_resent);
+        default:
+            return 0;
+    }
+}
+
+void ConnectionMetrics::notification_status(const M2MBase &base, const NoticationDeliveryStatus status,
+                                            void *client_args)
+{
+    (void)client_args;
+    if (_instance != NULL) {
+        _instance->record(base, status);
+    }
+}
+
+void ConnectionMetrics::notification_resent()
+{
+    if (_instance != NULL) {
+        increment(&_instance->_resent);
+    }
+}
+
+void ConnectionMetrics::increment(uint32_t *counter)
+{
+    uint32_t value = SPSC_LOAD_ACQUIRE(counter);
+    while (!SPSC_COMPARE_EXCHANGE(counter, value, value + 1)) {
+    }
+}
+
+void ConnectionMetrics::event_handler(arm_event_s &event)
+{
+    if (event.event_type == CONNECTION_METRICS_TASKLET_TIMER) {
+        publish();
+    }
+}
+
+void ConnectionMetrics::record(const M2MBase &base, NoticationDeliveryStatus status)
+{
+    PendingSend &pending = _pending[((uintptr_t)&base >> 4) % CONNECTION_METRICS_RTT_SLOTS];
+    const M2MBase *resource = &base;
+
+    switch (status) {
+        case NOTIFICATION_STATUS_SENT:
+            // Any thread calling set_value(), possibly several at once.
+            increment(&_sent);
+            SPSC_STORE_RELEASE(&pending.resource, (const M2MBase*)NULL);
+            SPSC_STORE_RELEASE(&pending.sent_ms, now_ms());
+            SPSC_STORE_RELEASE(&pending.resource, resource);
+            break;
+        case NOTIFICATION_STATUS_DELIVERED: {
+            uint32_t now = now_ms();
+            increment(&_delivered);
+            SPSC_STORE_RELEASE(&_last_delivery_ms, now);
+            if (SPSC_LOAD_ACQUIRE(&pending.resource) != resource) {
+                break;
+            }
+            uint32_t sent_ms = SPSC_LOAD_ACQUIRE(&pending.sent_ms);
+            if (SPSC_COMPARE_EXCHANGE(&pending.resource, resource, (const M2MBase*)NULL)) {
+                // SRTT += (RTT - SRTT) / 8, kept times 8.
+                uint32_t rtt = now - sent_ms;
+                SPSC_STORE_RELEASE(&_srtt_ms8, (_srtt_ms8 == 0) ? rtt * 8 : _srtt_ms8 - _srtt_ms8 / 8 + rtt);
+            }
+            break;
+        }
+        case NOTIFICATION_STATUS_BUILD_ERROR:
+        case NOTIFICATION_STATUS_RESEND_QUEUE_FULL:
+        case NOTIFICATION_STATUS_SEND_FAILED:
+            increment(&_failed);
+            SPSC_COMPARE_EXCHANGE(&pending.resource, resource, (const M2MBase*)NULL);
+            break;
+        default:
+            break;
+    }
+}
+
+void ConnectionMetrics::publish()
+{
+    for (int i = 0; i < CONNECTION_METRIC_COUNT; i++) {
+        _resources[i]->set_value(value((ConnectionMetric)i));
+    }
+}
@@ -0,0 +1,139 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#ifndef __CONNECTION_METRICS_H__
+#define __CONNECTION_METRICS_H__
+
+#include "nanostack-event-loop/eventOS_event.h"
+#include "m2mresource.h"
+
+#include <stdint.h>
+
+class SimpleM2MClient;
+
+// Least time between two refreshes of the metric resources, so observing
+// them costs at most one notification each per period.
+#ifndef CONNECTION_METRICS_PERIOD_MS
+#define CONNECTION_METRICS_PERIOD_MS 60000
+#endif
+
+// Notifications whose send time is kept to measure the round trip.
+#define CONNECTION_METRICS_RTT_SLOTS    32
+
+#define CONNECTION_METRICS_OBJECT_ID    5000
+
+typedef enum {
+    CONNECTION_METRIC_SENT,             // 5000/0/5, notifications sent
+    CONNECTION_METRIC_DELIVERED,        // 5000/0/6, notifications acknowledged
+    CONNECTION_METRIC_FAILED,           // 5000/0/7, notifications failed or dropped
+    CONNECTION_METRIC_RTT,              // 5000/0/8, smoothed round trip, ms
+    CONNECTION_METRIC_SINCE_DELIVERY,   // 5000/0/9, s since the last acknowledgement
+    CONNECTION_METRIC_RECONNECTS,       // 5000/0/10, reconnection attempts
+    CONNECTION_METRIC_DISCONNECTED,     // 5000/0/11, s spent disconnected
+    CONNECTION_METRIC_REG_UPDATES,      // 5000/0/12, registration updates sent
+    CONNECTION_METRIC_RESENT,           // 5000/0/13, failed notifications sent again
+    CONNECTION_METRIC_COUNT
+} ConnectionMetric;
+
+#define CONNECTION_METRICS_FIRST_RESOURCE_ID 5
+
+/**
+ * \brief Counters of the connection quality, published as observable
+ *        resources of 5000/0.
+ *
+ *        SimpleM2MClient hands notification_status() to every observable
+ *        resource created without a status callback of its own. The metric
+ *        resources have one that ignores the status, so the counters only
+ *        measure the traffic of the application.
+ *
+ *        The client reports NOTIFICATION_STATUS_SENT from set_value(), on
+ *        the thread setting the value, and the later statuses on its event
+ *        loop thread, so the counters are updated with atomic operations.
+ *        The round trip is the time from SENT to DELIVERED of the same
+ *        resource, smoothed like the TCP SRTT.
+ *
+ *        Client 1.3.3 does not report its CoAP retransmissions, so the
+ *        resent count is of the notifications that failed and were sent
+ *        again by the application, see notification_resent().
+ *
+ *        The resources are refreshed every CONNECTION_METRICS_PERIOD_MS by
+ *        a tasklet and only notify when a value changed.
+ */
+class ConnectionMetrics
+{
+    // Claimed by the resource pointer, which is cleared while sent_ms is
+    // written.
+    struct PendingSend {
+        const M2MBase *resource;
+        uint32_t    sent_ms;
+    };
+
+public:
+    ConnectionMetrics();
+
+    ~ConnectionMetrics();
+
+    /**
+     * \brief Creates the metric resources, must be called before
+     *        SimpleM2MClient::register_and_connect().
+     */
+    bool create_resources(SimpleM2MClient &client);
+
+    /**
+     * \brief Starts refreshing the resources.
+     */
+    bool start();
+
+    uint32_t value(ConnectionMetric metric) const;
+
+    static void notification_status(const M2MBase &base, const NoticationDeliveryStatus status,
+                                    void *client_args);
+
+    /**
+     * \brief Tells that a failed notification was sent again.
+     */
+    static void notification_resent();
+
+public:
+    void event_handler(arm_event_s &event);
+
+private:
+    void record(const M2MBase &base, NoticationDeliveryStatus status);
+    void publish();
+    static void increment(uint32_t *counter);
+
+private:
+    SimpleM2MClient *_client;
+    M2MResource *_resources[CONNECTION_METRIC_COUNT];
+    PendingSend _pending[CONNECTION_METRICS_RTT_SLOTS];
+    uint32_t    _sent;
+    uint32_t    _delivered;
+    uint32_t    _failed;
+    uint32_t    _resent;
+
+    // Only written by the event loop thread.
+    uint32_t    _srtt_ms8;          // smoothed round trip times 8
+    uint32_t    _last_delivery_ms;
+    arm_event_storage_t *_timer;
+
+    static ConnectionMetrics *_instance;
+    static int8_t _tasklet;
+};
+
+#endif /* __CONNECTION_METRICS_H__ */
@@ -0,0 +1,56 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#ifndef __ENDPOINT_HASH_H__
+#define __ENDPOINT_HASH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * \brief XXH64 of data with the given seed.
+ *
+ *        Stable across platforms and releases, so it can seed simulations
+ *        and place endpoints without coordination.
+ */
+uint64_t xxh64(const void *data, size_t length, uint64_t seed);
+
+/**
+ * \brief XXH64 of an endpoint name, with seed 0.
+ */
+uint64_t endpoint_hash(const char *name);
+
+/**
+ * \brief Maps a key to one of bucket_count buckets with the jump
+ *        consistent hash of Lamping and Veach.
+ *
+ *        Growing from n to n + 1 buckets only moves 1 / (n + 1) of the keys,
+ *        all of them to the new bucket, and shrinking only moves the keys of
+ *        the last bucket. Buckets are numbered, not named, so they must be
+ *        added and removed at the end.
+ */
+uint32_t jump_consistent_hash(uint64_t key, uint32_t bucket_count);
+
+/**
+ * \brief Bucket of the endpoint out of bucket_count, e.g. the gateway
+ *        process or worker serving it.
+ */
+uint32_t endpoint_bucket(const char *name, uint32_t bucket_count);
+
+#endif /* __ENDPOINT_HASH_H__ */
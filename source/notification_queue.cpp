@@ -0,0 +1,324 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "notification_queue.h"
+#include "connection_metrics.h"
+#include "spsc_queue.h"
+#include "mbed-client/m2mreporthandler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NOTIFICATION_QUEUE_NONE 0xFFFFFFFF
+
+NotificationQueue::NotificationQueue() : _entries(NULL), _capacity(0), _count(0), _queued(0), _forgotten(0),
+    _failed_seen(0), _coalesced(0), _resent(0), _dropped(0), _blocked(0), _sent(0), _finished(0), _failed(0)
+{
+    for (int i = 0; i < NOTIFICATION_PRIORITY_COUNT; i++) {
+        _head[i] = NOTIFICATION_QUEUE_NONE;
+        _tail[i] = NOTIFICATION_QUEUE_NONE;
+    }
+}
+
+NotificationQueue::~NotificationQueue()
+{
+    for (uint32_t i = 0; i < _count; i++) {
+        if (_entries[i].max_length > 0) {
+            free(_entries[i].payload);
+        }
+    }
+    free(_entries);
+}
+
+bool NotificationQueue::allocate(uint32_t capacity)
+{
+    _entries = (Entry*)calloc(capacity, sizeof(Entry));
+    if (_entries == NULL) {
+        return false;
+    }
+    _capacity = capacity;
+    return true;
+}
+
+uint32_t NotificationQueue::add(M2MResource *resource, uint16_t max_length)
+{
+    if (resource == NULL || _count >= _capacity) {
+        return NOTIFICATION_QUEUE_NO_HANDLE;
+    }
+
+    Entry &entry = _entries[_count];
+    entry.queue = this;
+    entry.resource = resource;
+    entry.max_length = max_length;
+    if (max_length > 0) {
+        entry.payload = (uint8_t*)malloc(max_length);
+        if (entry.payload == NULL) {
+            return NOTIFICATION_QUEUE_NO_HANDLE;
+        }
+    }
+    entry.priority = NOTIFICATION_PRIORITY_BULK;
+    resource->set_notification_delivery_status_cb(notification_status, &entry);
+    return _count++;
+}
+
+M2MResource *NotificationQueue::resource(uint32_t handle) const
+{
+    return (handle < _count) ? _entries[handle].resource : NULL;
+}
+
+NotificationResult NotificationQueue::set(uint32_t handle, int64_t value, NotificationPriority priority,
+                                          NotificationPolicy policy)
+{
+    Entry &entry = _entries[handle];
+    NotificationResult result = admit(handle, priority, policy);
+    if (result != NOTIFICATION_ACCEPTED) {
+        return result;
+    }
+    entry.value = value;
+    return push(handle, priority);
+}
+
+NotificationResult NotificationQueue::set(uint32_t handle, const uint8_t *value, uint16_t length,
+                                          NotificationPriority priority, NotificationPolicy policy)
+{
+    Entry &entry = _entries[handle];
+    if (length > entry.max_length) {
+        _dropped++;
+        return NOTIFICATION_DROPPED;
+    }
+    NotificationResult result = admit(handle, priority, policy);
+    if (result != NOTIFICATION_ACCEPTED) {
+        return result;
+    }
+    memcpy(entry.payload, value, length);
+    entry.length = length;
+    return push(handle, priority);
+}
+
+void NotificationQueue::pump()
+{
+    if (SPSC_LOAD_ACQUIRE(&_failed) != _failed_seen) {
+        resend_failed();
+    }
+
+    uint32_t open = SPSC_LOAD_ACQUIRE(&_finished);
+    open = SPSC_LOAD_ACQUIRE(&_sent) - open;
+    if (_forgotten > open) {
+        // Some of the forgotten notifications completed after all.
+        _forgotten = open;
+    }
+
+    uint32_t handle;
+    while (in_flight() < NOTIFICATION_QUEUE_WINDOW && pop(handle)) {
+        uint32_t failed = SPSC_LOAD_ACQUIRE(&_failed);
+        send(_entries[handle]);
+        if (SPSC_LOAD_ACQUIRE(&_failed) != failed) {
+            // Rejected right away, the resend queue is full.
+            break;
+        }
+    }
+}
+
+void NotificationQueue::reset()
+{
+    uint32_t finished = SPSC_LOAD_ACQUIRE(&_finished);
+    _forgotten = SPSC_LOAD_ACQUIRE(&_sent) - finished;
+
+    for (uint32_t i = 0; i < _count; i++) {
+        Entry &entry = _entries[i];
+        uint16_t entry_finished = SPSC_LOAD_ACQUIRE(&entry.finished);
+        entry.forgotten = (uint16_t)(SPSC_LOAD_ACQUIRE(&entry.sent) - entry_finished);
+    }
+}
+
+uint32_t NotificationQueue::queued() const
+{
+    return _queued;
+}
+
+uint32_t NotificationQueue::in_flight() const
+{
+    // Load the completions first, so that they never outnumber the sends.
+    uint32_t finished = SPSC_LOAD_ACQUIRE(&_finished);
+    uint32_t open = SPSC_LOAD_ACQUIRE(&_sent) - finished;
+    return (open > _forgotten) ? open - _forgotten : 0;
+}
+
+uint32_t NotificationQueue::depth(uint32_t handle) const
+{
+    const Entry &entry = _entries[handle];
+    uint16_t finished = SPSC_LOAD_ACQUIRE(&entry.finished);
+    uint16_t open = (uint16_t)(SPSC_LOAD_ACQUIRE(&entry.sent) - finished);
+    return (entry.pending ? 1 : 0) + ((open > entry.forgotten) ? open - entry.forgotten : 0);
+}
+
+bool NotificationQueue::congested() const
+{
+    return _queued + in_flight() >= NOTIFICATION_QUEUE_HIGH_WATER;
+}
+
+void NotificationQueue::print_statistics() const
+{
+    printf("Notifications: %lu queued, %lu in flight, %lu coalesced, %lu resent, %lu dropped, %lu blocked\n",
+           (unsigned long)_queued, (unsigned long)in_flight(), (unsigned long)_coalesced,
+           (unsigned long)_resent, (unsigned long)_dropped, (unsigned long)_blocked);
+}
+
+void NotificationQueue::notification_status(const M2MBase &base, const NoticationDeliveryStatus status,
+                                            void *client_args)
+{
+    Entry *entry = (Entry*)client_args;
+    NotificationQueue *queue = entry->queue;
+
+    switch (status) {
+        case NOTIFICATION_STATUS_SENT:
+            SPSC_STORE_RELEASE(&entry->sent, (uint16_t)(entry->sent + 1));
+            SPSC_STORE_RELEASE(&queue->_sent, queue->_sent + 1);
+            break;
+        case NOTIFICATION_STATUS_DELIVERED:
+            SPSC_STORE_RELEASE(&entry->finished, (uint16_t)(entry->finished + 1));
+            SPSC_STORE_RELEASE(&queue->_finished, queue->_finished + 1);
+            break;
+        case NOTIFICATION_STATUS_SEND_FAILED:
+            SPSC_STORE_RELEASE(&entry->finished, (uint16_t)(entry->finished + 1));
+            SPSC_STORE_RELEASE(&queue->_finished, queue->_finished + 1);
+            // fall through
+        case NOTIFICATION_STATUS_RESEND_QUEUE_FULL:
+            SPSC_STORE_RELEASE(&entry->failed, (uint16_t)(entry->failed + 1));
+            SPSC_STORE_RELEASE(&queue->_failed, queue->_failed + 1);
+            break;
+        default:
+            break;
+    }
+
+    ConnectionMetrics::notification_status(base, status, NULL);
+}
+
+NotificationResult NotificationQueue::admit(uint32_t handle, NotificationPriority priority,
+                                            NotificationPolicy policy)
+{
+    // A resource with nothing waiting nor in flight is never held back, so
+    // the busy resources cannot starve the quiet ones.
+    if (priority == NOTIFICATION_PRIORITY_CRITICAL || policy == NOTIFICATION_POLICY_COALESCE ||
+        !congested() || depth(handle) == 0) {
+        return NOTIFICATION_ACCEPTED;
+    }
+    if (policy == NOTIFICATION_POLICY_DROP) {
+        _dropped++;
+        return NOTIFICATION_DROPPED;
+    }
+    _blocked++;
+    return NOTIFICATION_BLOCKED;
+}
+
+NotificationResult NotificationQueue::push(uint32_t handle, NotificationPriority priority)
+{
+    Entry &entry = _entries[handle];
+    NotificationResult result = NOTIFICATION_ACCEPTED;
+
+    if (entry.pending) {
+        _coalesced++;
+        result = NOTIFICATION_COALESCED;
+    } else {
+        entry.pending = true;
+        entry.priority = (uint8_t)priority;
+        _queued++;
+    }
+    entry.trigger = false;
+    if (priority < entry.priority) {
+        entry.priority = (uint8_t)priority;
+    }
+
+    // An entry already waiting in a list of the same or a higher priority
+    // keeps its place, otherwise it joins the list of its priority too and
+    // is sent from whichever it reaches first.
+    for (int i = 0; i <= entry.priority; i++) {
+        if (entry.lists & (1 << i)) {
+            return result;
+        }
+    }
+    int list = entry.priority;
+    entry.lists |= (uint8_t)(1 << list);
+    entry.next[list] = NOTIFICATION_QUEUE_NONE;
+    if (_tail[list] == NOTIFICATION_QUEUE_NONE) {
+        _head[list] = handle;
+    } else {
+        _entries[_tail[list]].next[list] = handle;
+    }
+    _tail[list] = handle;
+    return result;
+}
+
+bool NotificationQueue::pop(uint32_t &handle)
+{
+    for (int list = 0; list < NOTIFICATION_PRIORITY_COUNT; list++) {
+        while (_head[list] != NOTIFICATION_QUEUE_NONE) {
+            handle = _head[list];
+            Entry &entry = _entries[handle];
+            _head[list] = entry.next[list];
+            if (_head[list] == NOTIFICATION_QUEUE_NONE) {
+                _tail[list] = NOTIFICATION_QUEUE_NONE;
+            }
+            entry.lists &= (uint8_t)~(1 << list);
+            if (entry.pending) {
+                return true;
+            }
+            // Already sent from a list of a higher priority.
+        }
+    }
+    return false;
+}
+
+void NotificationQueue::send(Entry &entry)
+{
+    entry.pending = false;
+    _queued--;
+
+    if (entry.trigger) {
+        // Nothing newer than the failed value, notify it again.
+        entry.trigger = false;
+        entry.resource->report_handler()->set_notification_trigger();
+    } else if (entry.max_length > 0) {
+        entry.resource->set_value(entry.payload, entry.length);
+    } else {
+        entry.resource->set_value(entry.value);
+    }
+}
+
+void NotificationQueue::resend_failed()
+{
+    _failed_seen = SPSC_LOAD_ACQUIRE(&_failed);
+
+    // Failures are rare, look for the entries behind them.
+    for (uint32_t i = 0; i < _count; i++) {
+        Entry &entry = _entries[i];
+        uint16_t failed = SPSC_LOAD_ACQUIRE(&entry.failed);
+        if (failed == entry.resent) {
+            continue;
+        }
+        entry.resent = failed;
+        if (!entry.pending) {
+            push(i, (NotificationPriority)entry.priority);
+            entry.trigger = true;
+            _resent++;
+            ConnectionMetrics::notification_resent();
+        }
+    }
+}
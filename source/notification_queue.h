@@ -0,0 +1,211 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#ifndef __NOTIFICATION_QUEUE_H__
+#define __NOTIFICATION_QUEUE_H__
+
+#include "m2mresource.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Notifications sent and not yet acknowledged at any time. Should not
+// exceed the resend queue of the client, SN_COAP_RESENDING_QUEUE_SIZE_MSGS,
+// whose default is 2.
+#ifndef NOTIFICATION_QUEUE_WINDOW
+#define NOTIFICATION_QUEUE_WINDOW 2
+#endif
+
+// Values waiting plus notifications in flight above which the queue is
+// congested, see NotificationPolicy.
+#ifndef NOTIFICATION_QUEUE_HIGH_WATER
+#define NOTIFICATION_QUEUE_HIGH_WATER 256
+#endif
+
+#define NOTIFICATION_QUEUE_NO_HANDLE    0xFFFFFFFF
+
+typedef enum {
+    NOTIFICATION_PRIORITY_CRITICAL,     // state edges, e.g. a shelf running empty
+    NOTIFICATION_PRIORITY_BULK,         // counters superseded by the next value
+    NOTIFICATION_PRIORITY_COUNT
+} NotificationPriority;
+
+// What set() does with a bulk value of a resource which has a value waiting
+// or in flight while the queue is congested. Critical values are always taken.
+typedef enum {
+    NOTIFICATION_POLICY_COALESCE,       // take it, replacing the value waiting
+    NOTIFICATION_POLICY_DROP,           // discard it
+    NOTIFICATION_POLICY_BLOCK           // refuse it, the producer retries later
+} NotificationPolicy;
+
+typedef enum {
+    NOTIFICATION_ACCEPTED,
+    NOTIFICATION_COALESCED,             // accepted, replacing the value waiting
+    NOTIFICATION_DROPPED,
+    NOTIFICATION_BLOCKED
+} NotificationResult;
+
+/**
+ * \brief Outbound queue of resource values, between the application and the
+ *        resend queue of the client.
+ *
+ *        Every resource gets one entry, so a resource is queued at most once
+ *        and a new value replaces the one still waiting (latest value wins).
+ *        The entries are allocated by add(), so the queue itself cannot
+ *        overflow. What happens to a value depends on the NotificationPolicy
+ *        once the queue is congested, see below: COALESCE keeps only the
+ *        latest value, DROP discards it and BLOCK refuses it so the producer
+ *        retries. An OPAQUE value longer than the max_length given to add()
+ *        is always dropped.
+ *
+ *        pump() hands the values to the client, critical ones first, while
+ *        fewer than NOTIFICATION_QUEUE_WINDOW notifications are in flight.
+ *        A notification is in flight from NOTIFICATION_STATUS_SENT to its
+ *        delivery or failure. A notification the client rejects with
+ *        NOTIFICATION_STATUS_RESEND_QUEUE_FULL or fails to deliver is queued
+ *        again with the priority of its value, unless a newer one is waiting.
+ *
+ *        Producers keep up with the client through depth() and congested().
+ *        Once the values waiting and the notifications in flight reach
+ *        NOTIFICATION_QUEUE_HIGH_WATER, set() applies the NotificationPolicy
+ *        given by the producer to the bulk values of the resources which
+ *        still have a value waiting or in flight.
+ *
+ *        set() and pump() must be called from one thread. The client may
+ *        report the status of the notifications from another one, the
+ *        status callback only updates counters owned by it.
+ */
+class NotificationQueue
+{
+    struct Entry {
+        NotificationQueue *queue;
+        M2MResource *resource;
+        union {
+            int64_t value;
+            uint8_t *payload;   // resources added with a max_length
+        };
+        uint32_t    next[NOTIFICATION_PRIORITY_COUNT];
+        uint16_t    length;
+        uint16_t    max_length;
+        uint16_t    sent;       // by the status callback
+        uint16_t    finished;   // by the status callback
+        uint16_t    failed;     // by the status callback
+        uint16_t    resent;     // by pump(), up to failed
+        uint16_t    forgotten;  // in flight at the last reset()
+        uint8_t     lists;      // bit per priority list holding the entry
+        uint8_t     priority;
+        bool        pending;
+        bool        trigger;    // resend the current value
+    };
+
+public:
+    NotificationQueue();
+
+    ~NotificationQueue();
+
+    /**
+     * \brief Allocates entries for capacity resources.
+     */
+    bool allocate(uint32_t capacity);
+
+    /**
+     * \brief Hands the resource to the queue, which takes over its status
+     *        callback. Values of an OPAQUE resource are copied, up to
+     *        max_length bytes.
+     *
+     * \return The handle of the resource, NOTIFICATION_QUEUE_NO_HANDLE when
+     *         the queue is full or the payload could not be allocated.
+     */
+    uint32_t add(M2MResource *resource, uint16_t max_length = 0);
+
+    M2MResource *resource(uint32_t handle) const;
+
+    /**
+     * \brief Queues a value of the resource, replacing the one waiting.
+     *        A critical value moves the resource ahead of the bulk ones.
+     *        While the queue is congested a bulk value is handled by policy.
+     *
+     * \return NOTIFICATION_DROPPED also when an OPAQUE value is longer than
+     *         the max_length of the resource.
+     */
+    NotificationResult set(uint32_t handle, int64_t value, NotificationPriority priority,
+                           NotificationPolicy policy = NOTIFICATION_POLICY_COALESCE);
+
+    NotificationResult set(uint32_t handle, const uint8_t *value, uint16_t length, NotificationPriority priority,
+                           NotificationPolicy policy = NOTIFICATION_POLICY_COALESCE);
+
+    /**
+     * \brief Sends the waiting values while the window has room.
+     */
+    void pump();
+
+    /**
+     * \brief Forgets the notifications in flight, whose status is never
+     *        reported once the client lost its registration.
+     */
+    void reset();
+
+    uint32_t queued() const;
+
+    uint32_t in_flight() const;
+
+    /**
+     * \brief Value waiting plus notifications in flight of the resource.
+     */
+    uint32_t depth(uint32_t handle) const;
+
+    /**
+     * \brief Whether the values waiting and the notifications in flight
+     *        reached NOTIFICATION_QUEUE_HIGH_WATER.
+     */
+    bool congested() const;
+
+    void print_statistics() const;
+
+    static void notification_status(const M2MBase &base, const NoticationDeliveryStatus status,
+                                    void *client_args);
+
+private:
+    NotificationResult admit(uint32_t handle, NotificationPriority priority, NotificationPolicy policy);
+    NotificationResult push(uint32_t handle, NotificationPriority priority);
+    bool pop(uint32_t &handle);
+    void send(Entry &entry);
+    void resend_failed();
+
+private:
+    Entry       *_entries;
+    uint32_t    _capacity;
+    uint32_t    _count;
+    uint32_t    _head[NOTIFICATION_PRIORITY_COUNT];
+    uint32_t    _tail[NOTIFICATION_PRIORITY_COUNT];
+    uint32_t    _queued;
+    uint32_t    _forgotten;     // in flight at the last reset()
+    uint32_t    _failed_seen;
+    uint64_t    _coalesced;
+    uint64_t    _resent;
+    uint64_t    _dropped;
+    uint64_t    _blocked;
+
+    // Written by the status callback only.
+    uint32_t    _sent;
+    uint32_t    _finished;
+    uint32_t    _failed;
+};
+
+#endif /* __NOTIFICATION_QUEUE_H__ */
@@ -0,0 +1,273 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "offline_buffer.h"
+#include "common_setup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OFFLINE_BUFFER_VERSION      1
+#define OFFLINE_BUFFER_RECORD_SIZE  12
+
+// Longest varint of a 32-bit value.
+#define OFFLINE_BUFFER_MAX_VARINT   5
+#define OFFLINE_BUFFER_HEADER_SIZE  (1 + 3 * OFFLINE_BUFFER_MAX_VARINT)
+#define OFFLINE_BUFFER_MAX_RECORD   (3 * OFFLINE_BUFFER_MAX_VARINT)
+
+static size_t write_varint(uint8_t *buffer, uint32_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+static void put_le32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *buffer)
+{
+    return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+OfflineBuffer::OfflineBuffer() : _fd(0), _buffer(NULL), _length(0), _written(0), _open(false),
+    _writing(false)
+{
+}
+
+OfflineBuffer::~OfflineBuffer()
+{
+    close();
+}
+
+bool OfflineBuffer::start()
+{
+    close();
+
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    if (mcc_platform_get_storage_file_path(OFFLINE_BUFFER_FILE_NAME, path, sizeof(path)) != 0) {
+        return false;
+    }
+
+    _buffer = (uint8_t*)malloc(OFFLINE_BUFFER_WRITE_RECORDS * OFFLINE_BUFFER_RECORD_SIZE);
+    if (_buffer == NULL) {
+        return false;
+    }
+
+    palStatus_t status = pal_fsFopen(path, PAL_FS_FLAG_READWRITETRUNC, &_fd);
+    if (status != PAL_SUCCESS) {
+        printf("Offline buffer: failed to open %s - %d\n", path, (int)status);
+        free(_buffer);
+        _buffer = NULL;
+        return false;
+    }
+
+    _open = true;
+    _writing = true;
+    return true;
+}
+
+bool OfflineBuffer::is_active() const
+{
+    return _writing;
+}
+
+void OfflineBuffer::append(uint32_t time, uint16_t shelf, ShelfJournalField field, uint32_t value)
+{
+    if (!_writing) {
+        return;
+    }
+
+    uint8_t *record = _buffer + _length * OFFLINE_BUFFER_RECORD_SIZE;
+    put_le32(record, time);
+    record[4] = (uint8_t)shelf;
+    record[5] = (uint8_t)(shelf >> 8);
+    record[6] = (uint8_t)field;
+    record[7] = 0;
+    put_le32(record + 8, value);
+
+    if (++_length == OFFLINE_BUFFER_WRITE_RECORDS) {
+        flush();
+    }
+}
+
+size_t OfflineBuffer::compact(uint16_t shelf_count, uint8_t *batch, size_t batch_size)
+{
+    // A failed write still leaves the transitions written before it.
+    flush();
+    if (!_open || _written == 0 || batch_size < OFFLINE_BUFFER_HEADER_SIZE) {
+        close();
+        return 0;
+    }
+
+    uint32_t first = (_written > OFFLINE_BUFFER_CAPACITY) ? _written - OFFLINE_BUFFER_CAPACITY : 0;
+
+    // Last value of each field of the shelves changed in the current period,
+    // and the shelves in the order they first changed in it.
+    uint32_t *values = (uint32_t*)malloc(shelf_count * 3 * sizeof(uint32_t));
+    uint8_t *changed = (uint8_t*)calloc(shelf_count, sizeof(uint8_t));
+    uint16_t *dirty = (uint16_t*)malloc(shelf_count * sizeof(uint16_t));
+    if (values == NULL || changed == NULL || dirty == NULL) {
+        free(values);
+        free(changed);
+        free(dirty);
+        close();
+        return 0;
+    }
+
+    size_t length = OFFLINE_BUFFER_HEADER_SIZE;
+    uint32_t left_out = 0;
+    uint32_t dirty_count = 0;
+    uint32_t period = 0;
+    uint32_t last_period = 0;
+
+    for (uint32_t i = first; i <= _written; i++) {
+        Record record;
+        bool valid = (i < _written) && read(i, record) && record.shelf < shelf_count && record.field < 3;
+        if (i < _written && !valid) {
+            continue;
+        }
+
+        // The shards run their own clocks, so a record may be older than the
+        // one before it. It then counts in the current period, which keeps
+        // the periods of the batch increasing. The records of one shelf come
+        // from one shard and stay in order.
+        uint32_t record_period = valid ? record.time / OFFLINE_BUFFER_RESOLUTION_MS : period;
+        if (record_period < period) {
+            record_period = period;
+        }
+
+        // Emit the previous period once it is over.
+        if (dirty_count > 0 && (!valid || record_period != period)) {
+            for (uint32_t d = 0; d < dirty_count; d++) {
+                uint16_t shelf = dirty[d];
+                for (int field = 0; field < 3; field++) {
+                    if ((changed[shelf] & (1 << field)) == 0) {
+                        continue;
+                    }
+                    if (batch_size - length < OFFLINE_BUFFER_MAX_RECORD) {
+                        left_out++;
+                        continue;
+                    }
+                    length += write_varint(batch + length, period - last_period);
+                    length += write_varint(batch + length, shelf);
+                    length += write_varint(batch + length, (values[shelf * 3 + field] << 2) | field);
+                    last_period = period;
+                }
+                changed[shelf] = 0;
+            }
+            dirty_count = 0;
+        }
+        if (!valid) {
+            break;
+        }
+
+        period = record_period;
+        if (changed[record.shelf] == 0) {
+            dirty[dirty_count++] = record.shelf;
+        }
+        changed[record.shelf] |= (uint8_t)(1 << record.field);
+        values[record.shelf * 3 + record.field] = record.value;
+    }
+
+    free(values);
+    free(changed);
+    free(dirty);
+    close();
+
+    uint8_t header[OFFLINE_BUFFER_HEADER_SIZE];
+    size_t header_length = 0;
+    header[header_length++] = OFFLINE_BUFFER_VERSION;
+    header_length += write_varint(header + header_length, OFFLINE_BUFFER_RESOLUTION_MS / 1000);
+    header_length += write_varint(header + header_length, first);
+    header_length += write_varint(header + header_length, left_out);
+
+    memmove(batch + header_length, batch + OFFLINE_BUFFER_HEADER_SIZE, length - OFFLINE_BUFFER_HEADER_SIZE);
+    memcpy(batch, header, header_length);
+    return length - OFFLINE_BUFFER_HEADER_SIZE + header_length;
+}
+
+void OfflineBuffer::close()
+{
+    if (_open) {
+        pal_fsFclose(&_fd);
+        _open = false;
+    }
+    _writing = false;
+    free(_buffer);
+    _buffer = NULL;
+    _length = 0;
+    _written = 0;
+}
+
+bool OfflineBuffer::flush()
+{
+    // Write the batch in at most two runs, split where the ring wraps.
+    uint32_t done = 0;
+    while (done < _length) {
+        uint32_t slot = (_written + done) % OFFLINE_BUFFER_CAPACITY;
+        uint32_t run = _length - done;
+        if (run > OFFLINE_BUFFER_CAPACITY - slot) {
+            run = OFFLINE_BUFFER_CAPACITY - slot;
+        }
+
+        size_t written = 0;
+        if (pal_fsFseek(&_fd, slot * OFFLINE_BUFFER_RECORD_SIZE, PAL_FS_OFFSET_SEEKSET) != PAL_SUCCESS ||
+            pal_fsFwrite(&_fd, _buffer + done * OFFLINE_BUFFER_RECORD_SIZE, run * OFFLINE_BUFFER_RECORD_SIZE,
+                         &written) != PAL_SUCCESS ||
+            written != run * OFFLINE_BUFFER_RECORD_SIZE) {
+            printf("Offline buffer: write failed, dropping %lu transitions and stopping the buffer\n",
+                   (unsigned long)(_length - done));
+            _writing = false;
+            break;
+        }
+        done += run;
+    }
+
+    _written += done;
+    _length = 0;
+    return _writing;
+}
+
+bool OfflineBuffer::read(uint32_t index, Record &record)
+{
+    uint8_t data[OFFLINE_BUFFER_RECORD_SIZE];
+    size_t read = 0;
+    uint32_t slot = index % OFFLINE_BUFFER_CAPACITY;
+
+    if (pal_fsFseek(&_fd, slot * OFFLINE_BUFFER_RECORD_SIZE, PAL_FS_OFFSET_SEEKSET) != PAL_SUCCESS ||
+        pal_fsFread(&_fd, data, sizeof(data), &read) != PAL_SUCCESS || read != sizeof(data)) {
+        return false;
+    }
+
+    record.time = get_le32(data);
+    record.shelf = (uint16_t)(data[4] | (data[5] << 8));
+    record.field = data[6];
+    record.value = get_le32(data + 8);
+    return true;
+}
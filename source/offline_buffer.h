@@ -0,0 +1,127 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __OFFLINE_BUFFER_H__
+#define __OFFLINE_BUFFER_H__
+
+#include "shelf_journal.h"
+#include "pal.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Name of the ring file in the primary partition.
+#ifndef OFFLINE_BUFFER_FILE_NAME
+#define OFFLINE_BUFFER_FILE_NAME "offline_buffer.bin"
+#endif
+
+// Number of transitions kept on disk, older ones are overwritten.
+#ifndef OFFLINE_BUFFER_CAPACITY
+#define OFFLINE_BUFFER_CAPACITY 8192
+#endif
+
+// Number of transitions batched in memory before a file write.
+#ifndef OFFLINE_BUFFER_WRITE_RECORDS
+#define OFFLINE_BUFFER_WRITE_RECORDS 32
+#endif
+
+// Time resolution of the compacted batch, only the last value of a field
+// within each period is kept.
+#ifndef OFFLINE_BUFFER_RESOLUTION_MS
+#define OFFLINE_BUFFER_RESOLUTION_MS 60000
+#endif
+
+// Largest compacted batch published after registration.
+#ifndef OFFLINE_BUFFER_BATCH_SIZE
+#define OFFLINE_BUFFER_BATCH_SIZE 1024
+#endif
+
+/**
+ * \brief Bounded ring of the shelf transitions made while the client is
+ *        not registered, kept on disk so a long outage costs no memory.
+ *
+ *        Transitions are fixed size records written in batches to a ring
+ *        file of OFFLINE_BUFFER_CAPACITY records, the oldest ones are
+ *        overwritten once it is full. After registration compact() turns
+ *        the ring into a single batch holding, for every period of
+ *        OFFLINE_BUFFER_RESOLUTION_MS, the last value of each field that
+ *        changed in it.
+ *
+ *        The batch starts with a version byte and three varints: the
+ *        resolution in seconds, the number of transitions lost to the ring
+ *        and the number left out because the batch was full. Then come
+ *        records of three varints like the sale log: the periods since the
+ *        previous record, the shelf and the value with the field in its two
+ *        lowest bits. Values are absolute, see ShelfJournalField. A
+ *        transition appended after a newer one, e.g. by another shard, is
+ *        reported in the period of the newer one.
+ */
+class OfflineBuffer
+{
+public:
+    OfflineBuffer();
+
+    ~OfflineBuffer();
+
+    /**
+     * \brief Starts buffering, discarding anything buffered before.
+     */
+    bool start();
+
+    /**
+     * \brief Whether transitions are still buffered, false once a write
+     *        failed. What was written before is still compacted.
+     */
+    bool is_active() const;
+
+    /**
+     * \brief Buffers a transition, time in ms since start().
+     */
+    void append(uint32_t time, uint16_t shelf, ShelfJournalField field, uint32_t value);
+
+    /**
+     * \brief Writes the compacted batch of the buffered transitions to
+     *        batch and stops buffering.
+     *
+     * \return the length of the batch, 0 if there was nothing to report.
+     */
+    size_t compact(uint16_t shelf_count, uint8_t *batch, size_t batch_size);
+
+    void close();
+
+private:
+    struct Record {
+        uint32_t    time;
+        uint16_t    shelf;
+        uint8_t     field;
+        uint32_t    value;
+    };
+
+    bool flush();
+    bool read(uint32_t index, Record &record);
+
+private:
+    palFileDescriptor_t _fd;
+    uint8_t     *_buffer;
+    uint32_t    _length;    // records in _buffer
+    uint32_t    _written;   // records written to the file since start()
+    bool        _open;
+    bool        _writing;
+};
+
+#endif /* __OFFLINE_BUFFER_H__ */
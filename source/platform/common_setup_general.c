@@ -17,8 +17,10 @@
 #include "common_setup.h"
 #include "common_config.h"
 #include "factory_configurator_client.h"
+#include "pal.h"
 
 #include <stdio.h>
+#include <string.h>
 
 int mcc_platform_reset_storage(void)
 {
@@ -43,6 +45,23 @@ int mcc_platform_reset_storage(void)
     return status;
 }
 
+int mcc_platform_get_storage_file_path(const char *file_name, char *path, size_t path_size)
+{
+    char mount_point[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    palStatus_t status = pal_fsGetMountPoint(PAL_FS_PARTITION_PRIMARY, PAL_MAX_FILE_AND_FOLDER_LENGTH, mount_point);
+    if (status != PAL_SUCCESS) {
+        printf("Fetching of PAL_FS_PARTITION_PRIMARY path failed - %d\n", (int)status);
+        return -1;
+    }
+
+    int length = snprintf(path, path_size, "%s/%s", mount_point, file_name);
+    if (length < 0 || (size_t)length >= path_size) {
+        printf("Path of %s is too long\n", file_name);
+        return -1;
+    }
+    return 0;
+}
+
 int mcc_platform_fcc_init(void)
 {
     int status = fcc_init();
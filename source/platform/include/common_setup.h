@@ -18,6 +18,7 @@
 #define COMMON_SETUP_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,11 @@ int mcc_platform_reset_storage(void);
 // creates default folders, reformat.
 int mcc_platform_storage_init(void);
 
+// Build the full path of a file in the primary storage partition.
+// @returns
+//   0 for success, anything else for error
+int mcc_platform_get_storage_file_path(const char *file_name, char *path, size_t path_size);
+
 // initialize common details for fcc.
 // reset storage to default if required.
 int mcc_platform_fcc_init(void);
@@ -0,0 +1,154 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "product_catalog.h"
+#include "common_setup.h"
+#include "pal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define PRODUCT_CATALOG_MAGIC       "PCAT"
+#define PRODUCT_CATALOG_VERSION     1
+#define PRODUCT_CATALOG_HEADER_SIZE 16
+
+#define LE32(value) (uint8_t)(value), (uint8_t)((value) >> 8), (uint8_t)((value) >> 16), (uint8_t)((value) >> 24)
+
+// The five products of the original example, in the catalog image format.
+static const uint8_t builtin_catalog[] = {
+    'P', 'C', 'A', 'T', LE32(PRODUCT_CATALOG_VERSION), LE32(5), LE32(66),
+    LE32(36), LE32(43), LE32(50), LE32(55), LE32(61),
+    6, 'A', 'p', 'p', 'l', 'e', 's',
+    6, 'C', 'h', 'e', 'e', 's', 'e',
+    4, 'M', 'i', 'l', 'k',
+    5, 'B', 'r', 'e', 'a', 'd',
+    4, 'B', 'e', 'e', 'r'
+};
+
+static uint32_t read_le32(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+ProductCatalog::ProductCatalog() : _image(NULL), _size(0), _count(0), _mapping(NULL)
+{
+}
+
+ProductCatalog::~ProductCatalog()
+{
+    unmap();
+}
+
+void ProductCatalog::load()
+{
+    unmap();
+
+#ifdef __linux__
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    if (mcc_platform_get_storage_file_path(PRODUCT_CATALOG_FILE_NAME, path, sizeof(path)) == 0) {
+        int fd = open(path, O_RDONLY);
+        struct stat info;
+        if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED) {
+                if (use((const uint8_t*)mapping, info.st_size)) {
+                    _mapping = mapping;
+                    printf("Product catalog: %s, %lu products\n", path, (unsigned long)_count);
+                } else {
+                    printf("Product catalog: %s is not a valid catalog\n", path);
+                    munmap(mapping, info.st_size);
+                }
+            }
+        }
+        if (fd >= 0) {
+            // The mapping stays valid after the descriptor is closed.
+            close(fd);
+        }
+    }
+#endif
+
+    if (_image == NULL) {
+        use(builtin_catalog, sizeof(builtin_catalog));
+    }
+}
+
+uint32_t ProductCatalog::count() const
+{
+    return _count;
+}
+
+bool ProductCatalog::name(uint32_t index, const uint8_t *&name, uint8_t &length) const
+{
+    if (index >= _count) {
+        return false;
+    }
+
+    uint32_t offset = read_le32(_image + PRODUCT_CATALOG_HEADER_SIZE + index * 4);
+    if (offset >= _size || _size - offset - 1 < _image[offset]) {
+        return false;
+    }
+
+    length = _image[offset];
+    name = _image + offset + 1;
+    return true;
+}
+
+bool ProductCatalog::use(const uint8_t *image, size_t size)
+{
+    if (size < PRODUCT_CATALOG_HEADER_SIZE ||
+        memcmp(image, PRODUCT_CATALOG_MAGIC, 4) != 0 ||
+        read_le32(image + 4) != PRODUCT_CATALOG_VERSION ||
+        read_le32(image + 12) != size) {
+        return false;
+    }
+
+    uint32_t count = read_le32(image + 8);
+    if (count > (size - PRODUCT_CATALOG_HEADER_SIZE) / 4) {
+        return false;
+    }
+    if (count > PRODUCT_CATALOG_MAX_PRODUCTS) {
+        printf("Product catalog: %lu products, at most %d are supported\n",
+               (unsigned long)count, PRODUCT_CATALOG_MAX_PRODUCTS);
+        return false;
+    }
+
+    _image = image;
+    _size = size;
+    _count = count;
+    return true;
+}
+
+void ProductCatalog::unmap()
+{
+#ifdef __linux__
+    if (_mapping) {
+        munmap(_mapping, _size);
+    }
+#endif
+    _mapping = NULL;
+    _image = NULL;
+    _size = 0;
+    _count = 0;
+}
@@ -0,0 +1,84 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __PRODUCT_CATALOG_H__
+#define __PRODUCT_CATALOG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Name of the catalog file in the primary partition.
+// Use tools/build_product_catalog.py to create one.
+#ifndef PRODUCT_CATALOG_FILE_NAME
+#define PRODUCT_CATALOG_FILE_NAME "product_catalog.bin"
+#endif
+
+// Largest number of products, the shelf store and the journal keep the
+// index of the product of a shelf in 16 bits.
+#define PRODUCT_CATALOG_MAX_PRODUCTS    0xFFFF
+
+/**
+ * \brief Read-only table of the product names used for product_id.
+ *
+ *        The catalog is a pre-built image which is used in place: on Linux
+ *        the catalog file is memory mapped, elsewhere, or if there is no
+ *        file, a built-in image of five products in flash is used. Loading
+ *        only validates the header, so it costs the same for any number of
+ *        products.
+ *
+ *        Image layout, all integers 32-bit little endian:
+ *          "PCAT", version, product count, size of the image
+ *          offset of the name of each product from the start of the image
+ *          names, each one a length byte followed by the name
+ *        Products with the same name share one entry in the names.
+ *        Catalogs of more than PRODUCT_CATALOG_MAX_PRODUCTS are refused.
+ */
+class ProductCatalog
+{
+public:
+    ProductCatalog();
+
+    ~ProductCatalog();
+
+    /**
+     * \brief Maps the catalog file, or falls back to the built-in catalog.
+     */
+    void load();
+
+    uint32_t count() const;
+
+    /**
+     * \brief Returns the name of a product without copying it. The name
+     *        is not null terminated.
+     *
+     * \return false if the index or the entry is out of range.
+     */
+    bool name(uint32_t index, const uint8_t *&name, uint8_t &length) const;
+
+private:
+    bool use(const uint8_t *image, size_t size);
+    void unmap();
+
+private:
+    const uint8_t   *_image;
+    size_t          _size;
+    uint32_t        _count;
+    void            *_mapping;
+};
+
+#endif /* __PRODUCT_CATALOG_H__ */
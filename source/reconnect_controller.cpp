@@ -0,0 +1,203 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "reconnect_controller.h"
+#include "pal.h"
+
+#include "nanostack-event-loop/eventOS_event_timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define RECONNECT_TASKLET_INIT_EVENT    0
+#define RECONNECT_TASKLET_ATTEMPT       10
+
+int8_t ReconnectController::_tasklet = -1;
+
+static uint64_t now_ms()
+{
+    return pal_osKernelSysMilliSecTick(pal_osKernelSysTick());
+}
+
+extern "C" {
+
+static void reconnect_event_handler_wrapper(arm_event_s *event)
+{
+    if (event->event_type != RECONNECT_TASKLET_INIT_EVENT) {
+        ReconnectController *instance = (ReconnectController *)event->data_ptr;
+        instance->event_handler(*event);
+    }
+}
+
+}
+
+ReconnectController::ReconnectController() : _cb(NULL), _context(NULL), _give_up_cb(NULL), _give_up_context(NULL),
+    _seeded(false), _pending(NULL),
+    _disconnected(false), _disconnected_since(0), _disconnected_total(0),
+    _sleep_ms(RECONNECT_BASE_DELAY_MS), _attempts(0), _successes(0), _failed_in_row(0)
+{
+}
+
+ReconnectController::~ReconnectController()
+{
+    if (_pending != NULL) {
+        eventOS_cancel(_pending);
+        _pending = NULL;
+    }
+}
+
+void ReconnectController::set_attempt_callback(attempt_cb cb, void *context)
+{
+    _cb = cb;
+    _context = context;
+}
+
+void ReconnectController::set_give_up_callback(give_up_cb cb, void *context)
+{
+    _give_up_cb = cb;
+    _give_up_context = context;
+}
+
+void ReconnectController::seed(uint64_t seed)
+{
+    _random.seed(seed);
+    _seeded = true;
+}
+
+bool ReconnectController::connection_lost()
+{
+    if (!_disconnected) {
+        _disconnected = true;
+        _disconnected_since = now_ms();
+    }
+    if (_pending != NULL) {
+        return true;
+    }
+#if RECONNECT_RETRY_BUDGET > 0
+    if (_failed_in_row >= RECONNECT_RETRY_BUDGET) {
+        printf("Reconnect: giving up after %lu attempts\n", (unsigned long)_failed_in_row);
+        return false;
+    }
+#endif
+    return schedule();
+}
+
+void ReconnectController::connected()
+{
+    if (_pending != NULL) {
+        eventOS_cancel(_pending);
+        _pending = NULL;
+    }
+    if (!_disconnected) {
+        return;
+    }
+
+    uint64_t outage = now_ms() - _disconnected_since;
+    _disconnected_total += outage;
+    _disconnected = false;
+    if (_failed_in_row > 0) {
+        _successes++;
+    }
+    printf("Reconnect: connected again after %lu ms and %lu attempts\n",
+           (unsigned long)outage, (unsigned long)_failed_in_row);
+    _failed_in_row = 0;
+    _sleep_ms = RECONNECT_BASE_DELAY_MS;
+}
+
+bool ReconnectController::is_disconnected() const
+{
+    return _disconnected;
+}
+
+uint32_t ReconnectController::attempts() const
+{
+    return _attempts;
+}
+
+uint32_t ReconnectController::successes() const
+{
+    return _successes;
+}
+
+uint64_t ReconnectController::disconnected_ms() const
+{
+    return _disconnected_total + (_disconnected ? now_ms() - _disconnected_since : 0);
+}
+
+void ReconnectController::print_statistics() const
+{
+    printf("Reconnect: %lu attempts, %lu successful, %lu ms disconnected\n",
+           (unsigned long)_attempts, (unsigned long)_successes, (unsigned long)disconnected_ms());
+}
+
+void ReconnectController::event_handler(arm_event_s &event)
+{
+    if (event.event_type != RECONNECT_TASKLET_ATTEMPT) {
+        return;
+    }
+
+    _pending = NULL;
+    if (!_disconnected) {
+        return;
+    }
+
+    _attempts++;
+    _failed_in_row++;
+    if (_cb == NULL || !_cb(_context)) {
+        // Failed before reaching the network, no error callback will follow.
+        if (!connection_lost() && _give_up_cb != NULL) {
+            _give_up_cb(_give_up_context);
+        }
+    }
+}
+
+bool ReconnectController::schedule()
+{
+    if (_tasklet < 0) {
+        _tasklet = eventOS_event_handler_create(reconnect_event_handler_wrapper, RECONNECT_TASKLET_INIT_EVENT);
+        if (_tasklet < 0) {
+            return false;
+        }
+    }
+    if (!_seeded) {
+        seed(now_ms());
+    }
+
+    // Decorrelated jitter: sleep = min(cap, random(base, 3 * sleep)).
+    uint64_t upper = (uint64_t)_sleep_ms * 3;
+    if (upper > RECONNECT_MAX_DELAY_MS) {
+        upper = RECONNECT_MAX_DELAY_MS;
+    }
+    _sleep_ms = _random.range(RECONNECT_BASE_DELAY_MS, (uint32_t)upper);
+
+    arm_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.event_type = RECONNECT_TASKLET_ATTEMPT;
+    event.receiver = _tasklet;
+    event.sender = _tasklet;
+    event.data_ptr = this;
+    event.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+    _pending = eventOS_event_send_after(&event, eventOS_event_timer_ms_to_ticks(_sleep_ms));
+    if (_pending == NULL) {
+        printf("Reconnect: failed to schedule an attempt\n");
+        return false;
+    }
+    printf("Reconnect: next attempt in %lu ms\n", (unsigned long)_sleep_ms);
+    return true;
+}
@@ -0,0 +1,136 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#ifndef __RECONNECT_CONTROLLER_H__
+#define __RECONNECT_CONTROLLER_H__
+
+#include "nanostack-event-loop/eventOS_event.h"
+#include "sim_random.h"
+
+#include <stdint.h>
+
+// Shortest wait before a reconnection attempt.
+#ifndef RECONNECT_BASE_DELAY_MS
+#define RECONNECT_BASE_DELAY_MS 1000
+#endif
+
+// Longest wait before a reconnection attempt.
+#ifndef RECONNECT_MAX_DELAY_MS
+#define RECONNECT_MAX_DELAY_MS (5 * 60 * 1000)
+#endif
+
+// Attempts in a row after which the controller gives up, 0 never does.
+#ifndef RECONNECT_RETRY_BUDGET
+#define RECONNECT_RETRY_BUDGET 0
+#endif
+
+/**
+ * \brief Schedules the reconnections of the client after it lost the
+ *        connection, on the client event loop.
+ *
+ *        The waits follow the decorrelated jitter backoff: each one is
+ *        drawn between RECONNECT_BASE_DELAY_MS and three times the previous
+ *        one, capped at RECONNECT_MAX_DELAY_MS. The waits grow about
+ *        exponentially like a plain backoff, but devices that lost the
+ *        connection at the same moment quickly drift apart instead of
+ *        hitting the service in waves.
+ *
+ *        connection_lost() and connected() must be called from the client
+ *        callbacks, i.e. the event loop thread, which also runs the
+ *        attempt callback.
+ */
+class ReconnectController
+{
+public:
+    /**
+     * \brief Starts a reconnection, returns false if it failed at once.
+     */
+    typedef bool (*attempt_cb)(void *context);
+
+    /**
+     * \brief Called when an attempt failed at once and the retry budget is
+     *        spent, as no client callback reports that failure.
+     */
+    typedef void (*give_up_cb)(void *context);
+
+    ReconnectController();
+
+    ~ReconnectController();
+
+    void set_attempt_callback(attempt_cb cb, void *context);
+
+    void set_give_up_callback(give_up_cb cb, void *context);
+
+    /**
+     * \brief Seeds the jitter, e.g. with the hash of the endpoint name so
+     *        that devices do not draw the same waits.
+     */
+    void seed(uint64_t seed);
+
+    /**
+     * \brief Schedules an attempt unless one is already waiting.
+     *
+     * \return false once RECONNECT_RETRY_BUDGET attempts in a row failed.
+     */
+    bool connection_lost();
+
+    /**
+     * \brief Cancels the waiting attempt and resets the backoff.
+     */
+    void connected();
+
+    bool is_disconnected() const;
+
+    uint32_t attempts() const;
+
+    uint32_t successes() const;
+
+    /**
+     * \brief Time spent disconnected, including the current outage.
+     */
+    uint64_t disconnected_ms() const;
+
+    void print_statistics() const;
+
+public:
+    void event_handler(arm_event_s &event);
+
+private:
+    bool schedule();
+
+private:
+    attempt_cb  _cb;
+    void        *_context;
+    give_up_cb  _give_up_cb;
+    void        *_give_up_context;
+    SimRandom   _random;
+    bool        _seeded;
+    arm_event_storage_t *_pending;
+    bool        _disconnected;
+    uint64_t    _disconnected_since;
+    uint64_t    _disconnected_total;
+    uint32_t    _sleep_ms;
+    uint32_t    _attempts;
+    uint32_t    _successes;
+    uint32_t    _failed_in_row;
+
+    static int8_t _tasklet;
+};
+
+#endif /* __RECONNECT_CONTROLLER_H__ */
@@ -0,0 +1,176 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "registration_scheduler.h"
+#include "spsc_queue.h"
+#include "pal.h"
+
+#include "nanostack-event-loop/eventOS_event_timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define REGISTRATION_TASKLET_INIT_EVENT 0
+#define REGISTRATION_TASKLET_DUE        10
+#define REGISTRATION_TASKLET_TRAFFIC    11
+
+int8_t RegistrationScheduler::_tasklet = -1;
+
+static uint32_t now_ms()
+{
+    return (uint32_t)pal_osKernelSysMilliSecTick(pal_osKernelSysTick());
+}
+
+extern "C" {
+
+static void registration_event_handler_wrapper(arm_event_s *event)
+{
+    if (event->event_type != REGISTRATION_TASKLET_INIT_EVENT) {
+        RegistrationScheduler *instance = (RegistrationScheduler *)event->data_ptr;
+        instance->event_handler(*event);
+    }
+}
+
+}
+
+RegistrationScheduler::RegistrationScheduler() : _cb(NULL), _context(NULL), _pending(NULL), _period_ms(0),
+    _running(false), _updates(0), _piggybacked(0), _early_at(0), _armed(0), _generation(0)
+{
+}
+
+RegistrationScheduler::~RegistrationScheduler()
+{
+    stop();
+}
+
+void RegistrationScheduler::set_update_callback(update_cb cb, void *context)
+{
+    _cb = cb;
+    _context = context;
+}
+
+void RegistrationScheduler::start(uint64_t key, uint32_t lifetime_s)
+{
+    if (_tasklet < 0) {
+        _tasklet = eventOS_event_handler_create(registration_event_handler_wrapper, REGISTRATION_TASKLET_INIT_EVENT);
+        if (_tasklet < 0) {
+            printf("Registration updates: failed to create the tasklet\n");
+            return;
+        }
+    }
+
+    _period_ms = (uint32_t)((uint64_t)lifetime_s * 10 * REGISTRATION_UPDATE_PERIOD_PERCENT);
+    if (_period_ms < 2) {
+        return;
+    }
+    _running = true;
+    schedule(_period_ms / 2 + (uint32_t)(key % (_period_ms / 2)));
+}
+
+void RegistrationScheduler::stop()
+{
+    _running = false;
+    cancel();
+}
+
+void RegistrationScheduler::traffic()
+{
+    if (!SPSC_LOAD_ACQUIRE(&_armed) || (int32_t)(now_ms() - SPSC_LOAD_ACQUIRE(&_early_at)) < 0) {
+        return;
+    }
+
+    // Only the first caller in the early window sends the update.
+    int32_t armed = 1;
+    if (!SPSC_COMPARE_EXCHANGE(&_armed, armed, 0)) {
+        return;
+    }
+
+    arm_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.event_type = REGISTRATION_TASKLET_TRAFFIC;
+    event.event_data = SPSC_LOAD_ACQUIRE(&_generation);
+    event.receiver = _tasklet;
+    event.sender = _tasklet;
+    event.data_ptr = this;
+    event.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+    eventOS_event_send(&event);
+}
+
+uint32_t RegistrationScheduler::updates() const
+{
+    return _updates;
+}
+
+uint32_t RegistrationScheduler::piggybacked() const
+{
+    return _piggybacked;
+}
+
+void RegistrationScheduler::event_handler(arm_event_s &event)
+{
+    if (event.event_type == REGISTRATION_TASKLET_DUE) {
+        _pending = NULL;
+    } else if (event.event_type != REGISTRATION_TASKLET_TRAFFIC || event.event_data != _generation) {
+        return;
+    }
+    if (!_running) {
+        return;
+    }
+
+    if (event.event_type == REGISTRATION_TASKLET_TRAFFIC) {
+        _piggybacked++;
+    }
+    _updates++;
+    if (_cb) {
+        _cb(_context);
+    }
+    schedule(_period_ms);
+}
+
+void RegistrationScheduler::schedule(uint32_t delay_ms)
+{
+    cancel();
+
+    arm_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.event_type = REGISTRATION_TASKLET_DUE;
+    event.receiver = _tasklet;
+    event.sender = _tasklet;
+    event.data_ptr = this;
+    event.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+    _pending = eventOS_event_send_after(&event, eventOS_event_timer_ms_to_ticks(delay_ms));
+    if (_pending == NULL) {
+        printf("Registration updates: failed to schedule the next update\n");
+        return;
+    }
+
+    SPSC_STORE_RELEASE(&_generation, _generation + 1);
+    uint32_t early = (uint32_t)((uint64_t)_period_ms * REGISTRATION_UPDATE_EARLY_PERCENT / 100);
+    SPSC_STORE_RELEASE(&_early_at, now_ms() + ((delay_ms > early) ? delay_ms - early : 0));
+    SPSC_STORE_RELEASE(&_armed, 1);
+}
+
+void RegistrationScheduler::cancel()
+{
+    SPSC_STORE_RELEASE(&_armed, 0);
+    if (_pending != NULL) {
+        eventOS_cancel(_pending);
+        _pending = NULL;
+    }
+}
@@ -0,0 +1,127 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#ifndef __REGISTRATION_SCHEDULER_H__
+#define __REGISTRATION_SCHEDULER_H__
+
+#include "nanostack-event-loop/eventOS_event.h"
+
+#include <stdint.h>
+
+// Whether the application schedules the registration updates itself.
+#ifndef REGISTRATION_UPDATE_ENABLED
+#define REGISTRATION_UPDATE_ENABLED 1
+#endif
+
+// Lifetime of the registration in seconds.
+#ifndef REGISTRATION_UPDATE_LIFETIME_S
+#ifdef MBED_CLOUD_CLIENT_LIFETIME
+#define REGISTRATION_UPDATE_LIFETIME_S MBED_CLOUD_CLIENT_LIFETIME
+#else
+#define REGISTRATION_UPDATE_LIFETIME_S 3600
+#endif
+#endif
+
+// Period of the updates as a share of the lifetime, in percent. Below the
+// three quarters after which the client refreshes the registration by
+// itself, so every update restarts that timer and the client never sends
+// its own: the devices keep one refresh per period, just spread out.
+#ifndef REGISTRATION_UPDATE_PERIOD_PERCENT
+#define REGISTRATION_UPDATE_PERIOD_PERCENT 70
+#endif
+
+// Share of the period, at its end, in which an update is sent early if
+// notifications are going out anyway.
+#ifndef REGISTRATION_UPDATE_EARLY_PERCENT
+#define REGISTRATION_UPDATE_EARLY_PERCENT 20
+#endif
+
+/**
+ * \brief Sends the registration updates of the client, spread over the
+ *        lifetime instead of at the same moment on every device.
+ *
+ *        Updates replace the refreshes of the client rather than adding
+ *        to them: they are sent every REGISTRATION_UPDATE_PERIOD_PERCENT
+ *        of the lifetime, just before the client would refresh the
+ *        registration by itself. The first one comes in the second half of
+ *        that period, at a point set by the key, so devices registered
+ *        together keep refreshing at different times. Once the update is
+ *        within REGISTRATION_UPDATE_EARLY_PERCENT of the period, traffic()
+ *        sends it right away, while the connection is busy anyway.
+ *
+ *        start() and stop() must be called on the client event loop thread,
+ *        which also runs the update callback. traffic() may be called from
+ *        any thread.
+ */
+class RegistrationScheduler
+{
+public:
+    typedef void (*update_cb)(void *context);
+
+    RegistrationScheduler();
+
+    ~RegistrationScheduler();
+
+    void set_update_callback(update_cb cb, void *context);
+
+    /**
+     * \brief Schedules the updates of a new registration, placed by key,
+     *        e.g. the hash of the endpoint name.
+     */
+    void start(uint64_t key, uint32_t lifetime_s = REGISTRATION_UPDATE_LIFETIME_S);
+
+    void stop();
+
+    /**
+     * \brief Tells that messages were just sent.
+     */
+    void traffic();
+
+    uint32_t updates() const;
+
+    /**
+     * \brief Updates sent early along with other traffic.
+     */
+    uint32_t piggybacked() const;
+
+public:
+    void event_handler(arm_event_s &event);
+
+private:
+    void schedule(uint32_t delay_ms);
+    void cancel();
+
+private:
+    update_cb   _cb;
+    void        *_context;
+    arm_event_storage_t *_pending;
+    uint32_t    _period_ms;
+    bool        _running;
+    uint32_t    _updates;
+    uint32_t    _piggybacked;
+
+    // Shared with traffic(), in ms of the PAL tick.
+    uint32_t    _early_at;
+    int32_t     _armed;
+    uint32_t    _generation;   // of the schedule, drops stale traffic events
+
+    static int8_t _tasklet;
+};
+
+#endif /* __REGISTRATION_SCHEDULER_H__ */
@@ -0,0 +1,221 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "sale_log.h"
+#include "common_setup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SALE_LOG_MAGIC      "SLOG"
+#define SALE_LOG_VERSION    1
+#define SALE_LOG_HEADER_SIZE 8
+
+// Longest varint of a 64-bit value.
+#define SALE_LOG_MAX_VARINT 10
+#define SALE_LOG_MAX_RECORD (3 * SALE_LOG_MAX_VARINT)
+
+static size_t write_varint(uint8_t *buffer, uint64_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+SaleLog::SaleLog() : _fd(0), _buffer(NULL), _length(0), _position(0), _time(0), _open(false), _writing(false)
+{
+}
+
+SaleLog::~SaleLog()
+{
+    close();
+}
+
+bool SaleLog::open_for_record(uint16_t shelf_count)
+{
+    if (!open(PAL_FS_FLAG_READWRITETRUNC)) {
+        return false;
+    }
+    _writing = true;
+
+    uint8_t header[SALE_LOG_HEADER_SIZE];
+    memcpy(header, SALE_LOG_MAGIC, 4);
+    header[4] = SALE_LOG_VERSION;
+    header[5] = 0;
+    header[6] = (uint8_t)shelf_count;
+    header[7] = (uint8_t)(shelf_count >> 8);
+
+    memcpy(_buffer, header, sizeof(header));
+    _length = sizeof(header);
+
+    return flush();
+}
+
+bool SaleLog::open_for_replay(uint16_t &shelf_count)
+{
+    if (!open(PAL_FS_FLAG_READONLY)) {
+        return false;
+    }
+    _writing = false;
+
+    uint8_t header[SALE_LOG_HEADER_SIZE];
+    size_t read = 0;
+    palStatus_t status = pal_fsFread(&_fd, header, sizeof(header), &read);
+    if (status != PAL_SUCCESS || read != sizeof(header) ||
+        memcmp(header, SALE_LOG_MAGIC, 4) != 0 || header[4] != SALE_LOG_VERSION) {
+        printf("Sale log: invalid header\n");
+        close();
+        return false;
+    }
+
+    shelf_count = header[6] | (header[7] << 8);
+    return true;
+}
+
+bool SaleLog::is_open() const
+{
+    return _open;
+}
+
+void SaleLog::append(uint64_t time, uint16_t shelf, SaleLogEvent event, int32_t value)
+{
+    if (!_open || !_writing) {
+        return;
+    }
+
+    if (SALE_LOG_BUFFER_SIZE - _length < SALE_LOG_MAX_RECORD) {
+        if (!flush()) {
+            return;
+        }
+    }
+
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+
+    _length += write_varint(_buffer + _length, time - _time);
+    _length += write_varint(_buffer + _length, shelf);
+    _length += write_varint(_buffer + _length, ((uint64_t)zigzag << 2) | event);
+    _time = time;
+}
+
+bool SaleLog::read(SaleLogRecord &record)
+{
+    if (!_open || _writing) {
+        return false;
+    }
+
+    uint64_t delta;
+    uint64_t shelf;
+    uint64_t value;
+    if (!read_varint(delta) || !read_varint(shelf) || !read_varint(value)) {
+        return false;
+    }
+
+    uint32_t zigzag = (uint32_t)(value >> 2);
+
+    _time += delta;
+    record.time = _time;
+    record.shelf = (uint16_t)shelf;
+    record.event = (uint8_t)(value & 0x3);
+    record.value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    return true;
+}
+
+void SaleLog::close()
+{
+    if (_open) {
+        if (_writing) {
+            flush();
+        }
+        pal_fsFclose(&_fd);
+    }
+    free(_buffer);
+    _buffer = NULL;
+    _open = false;
+    _length = 0;
+    _position = 0;
+    _time = 0;
+}
+
+bool SaleLog::open(pal_fsFileMode_t mode)
+{
+    close();
+
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    if (mcc_platform_get_storage_file_path(SALE_LOG_FILE_NAME, path, sizeof(path)) != 0) {
+        return false;
+    }
+
+    _buffer = (uint8_t*)malloc(SALE_LOG_BUFFER_SIZE);
+    if (_buffer == NULL) {
+        return false;
+    }
+
+    palStatus_t status = pal_fsFopen(path, mode, &_fd);
+    if (status != PAL_SUCCESS) {
+        printf("Sale log: failed to open %s - %d\n", path, (int)status);
+        free(_buffer);
+        _buffer = NULL;
+        return false;
+    }
+
+    _open = true;
+    return true;
+}
+
+bool SaleLog::flush()
+{
+    size_t written = 0;
+    palStatus_t status = pal_fsFwrite(&_fd, _buffer, _length, &written);
+    if (status != PAL_SUCCESS || written != _length) {
+        printf("Sale log: write failed, closing the log\n");
+        _length = 0;
+        _writing = false;
+        close();
+        return false;
+    }
+    _length = 0;
+    return true;
+}
+
+bool SaleLog::read_varint(uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 7 * SALE_LOG_MAX_VARINT; shift += 7) {
+        if (_position == _length) {
+            size_t read = 0;
+            palStatus_t status = pal_fsFread(&_fd, _buffer, SALE_LOG_BUFFER_SIZE, &read);
+            if (status != PAL_SUCCESS || read == 0) {
+                return false;
+            }
+            _length = read;
+            _position = 0;
+        }
+
+        uint8_t byte = _buffer[_position++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
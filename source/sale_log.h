@@ -0,0 +1,120 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SALE_LOG_H__
+#define __SALE_LOG_H__
+
+#include "pal.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SALE_LOG_MODE_OFF       0
+#define SALE_LOG_MODE_RECORD    1
+#define SALE_LOG_MODE_REPLAY    2
+
+// Whether the shelf engine records its transitions into the sale log,
+// or replays a previously recorded log instead of simulating.
+#ifndef SALE_LOG_MODE
+#define SALE_LOG_MODE SALE_LOG_MODE_OFF
+#endif
+
+// Name of the log file in the primary partition.
+#ifndef SALE_LOG_FILE_NAME
+#define SALE_LOG_FILE_NAME "sale_log.bin"
+#endif
+
+// Size of the buffer used for batching file writes and reads.
+#ifndef SALE_LOG_BUFFER_SIZE
+#define SALE_LOG_BUFFER_SIZE 512
+#endif
+
+typedef enum {
+    SALE_LOG_EVENT_COUNT    = 0, // value is added to product_current_count
+    SALE_LOG_EVENT_EMPTY    = 1, // value is the new product_empty
+    SALE_LOG_EVENT_PRODUCT  = 2  // value is the index of the new product_id
+} SaleLogEvent;
+
+struct SaleLogRecord {
+    uint64_t    time;   // ms since the start of the log
+    uint16_t    shelf;
+    uint8_t     event;
+    int32_t     value;
+};
+
+/**
+ * \brief Append-only binary log of the shelf transitions.
+ *
+ *        The file starts with a header holding the number of shelves,
+ *        followed by one record per transition encoded as three varints:
+ *        the time since the previous record, the shelf and the zig-zag
+ *        encoded value with the event type in its two lowest bits. A typical
+ *        record takes three to four bytes. A record cut short by a crash ends
+ *        the replay at that point.
+ */
+class SaleLog
+{
+public:
+    SaleLog();
+
+    ~SaleLog();
+
+    /**
+     * \brief Creates a new log, replacing any previous one.
+     */
+    bool open_for_record(uint16_t shelf_count);
+
+    /**
+     * \brief Opens an existing log and returns the number of shelves in it.
+     */
+    bool open_for_replay(uint16_t &shelf_count);
+
+    bool is_open() const;
+
+    /**
+     * \brief Appends a record, time being ms since the start of the log.
+     *        Records must be appended in time order.
+     */
+    void append(uint64_t time, uint16_t shelf, SaleLogEvent event, int32_t value);
+
+    /**
+     * \brief Reads the next record, returns false at the end of the log.
+     */
+    bool read(SaleLogRecord &record);
+
+    /**
+     * \brief Writes out any buffered records and closes the file.
+     */
+    void close();
+
+private:
+    bool open(pal_fsFileMode_t mode);
+    bool flush();
+    bool read_varint(uint64_t &value);
+
+private:
+    palFileDescriptor_t _fd;
+    uint8_t             *_buffer;
+    size_t              _length;
+    size_t              _position;
+    uint64_t            _time;
+    bool                _open;
+    bool                _writing;
+};
+
+#endif /* __SALE_LOG_H__ */
@@ -0,0 +1,100 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "sales_rate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+SalesRateTracker::SalesRateTracker() : _rates(NULL), _size(0)
+{
+}
+
+SalesRateTracker::~SalesRateTracker()
+{
+    free(_rates);
+}
+
+bool SalesRateTracker::allocate(uint16_t shelf_count)
+{
+    free(_rates);
+    _rates = (Rates*)calloc(shelf_count, sizeof(Rates));
+    _size = _rates ? shelf_count : 0;
+    return _rates != NULL;
+}
+
+void SalesRateTracker::record_sale(uint16_t shelf, uint32_t time)
+{
+    Rates &rates = _rates[shelf];
+    advance(rates, time);
+
+    uint8_t &second = rates.seconds[rates.second_slot % SECOND_BUCKETS];
+    if (second < UINT8_MAX) {
+        second++;
+        rates.sums[SALES_RATE_1_MIN]++;
+    }
+
+    uint16_t &minute = rates.minutes[rates.minute_slot % MINUTE_BUCKETS];
+    if (minute < UINT16_MAX && rates.sums[SALES_RATE_1_HOUR] < UINT16_MAX) {
+        minute++;
+        rates.sums[SALES_RATE_15_MIN]++;
+        rates.sums[SALES_RATE_1_HOUR]++;
+    }
+}
+
+uint16_t SalesRateTracker::sales(uint16_t shelf, SalesRateWindow window, uint32_t time)
+{
+    Rates &rates = _rates[shelf];
+    advance(rates, time);
+    return rates.sums[window];
+}
+
+void SalesRateTracker::advance(Rates &rates, uint32_t time)
+{
+    uint32_t second_slot = time / SECOND_BUCKET_S;
+    if (second_slot - rates.second_slot >= SECOND_BUCKETS) {
+        // The whole minute window has passed.
+        memset(rates.seconds, 0, sizeof(rates.seconds));
+        rates.sums[SALES_RATE_1_MIN] = 0;
+        rates.second_slot = second_slot;
+    }
+    while (rates.second_slot < second_slot) {
+        rates.second_slot++;
+        uint8_t &bucket = rates.seconds[rates.second_slot % SECOND_BUCKETS];
+        rates.sums[SALES_RATE_1_MIN] -= bucket;
+        bucket = 0;
+    }
+
+    uint32_t minute_slot = time / MINUTE_BUCKET_S;
+    if (minute_slot - rates.minute_slot >= MINUTE_BUCKETS) {
+        memset(rates.minutes, 0, sizeof(rates.minutes));
+        rates.sums[SALES_RATE_15_MIN] = 0;
+        rates.sums[SALES_RATE_1_HOUR] = 0;
+        rates.minute_slot = minute_slot;
+    }
+    while (rates.minute_slot < minute_slot) {
+        rates.minute_slot++;
+        // The bucket 15 minutes back leaves the 15 minute window and the
+        // bucket about to be reused leaves the hour window.
+        uint32_t leaving = (rates.minute_slot + MINUTE_BUCKETS - QUARTER_BUCKETS) % MINUTE_BUCKETS;
+        rates.sums[SALES_RATE_15_MIN] -= rates.minutes[leaving];
+        uint16_t &bucket = rates.minutes[rates.minute_slot % MINUTE_BUCKETS];
+        rates.sums[SALES_RATE_1_HOUR] -= bucket;
+        bucket = 0;
+    }
+}
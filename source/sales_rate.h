@@ -0,0 +1,87 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SALES_RATE_H__
+#define __SALES_RATE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    SALES_RATE_1_MIN,
+    SALES_RATE_15_MIN,
+    SALES_RATE_1_HOUR,
+    SALES_RATE_WINDOW_COUNT
+} SalesRateWindow;
+
+/**
+ * \brief Number of sales of each shelf over sliding windows of one minute,
+ *        15 minutes and one hour.
+ *
+ *        Every shelf has a ring of 12 five second buckets for the minute
+ *        window and a ring of 60 one minute buckets for the two others, with
+ *        a running sum per window. A sale only increments the current buckets
+ *        and the sums, and buckets leaving a window are subtracted as time
+ *        moves on, so the cost per sale is O(1) amortized. The windows move
+ *        in bucket steps, i.e. the minute window covers between 55 and 60
+ *        seconds.
+ */
+class SalesRateTracker
+{
+    enum {
+        SECOND_BUCKET_S     = 5,
+        SECOND_BUCKETS      = 12,
+        MINUTE_BUCKET_S     = 60,
+        MINUTE_BUCKETS      = 60,
+        QUARTER_BUCKETS     = 15
+    };
+
+    struct Rates {
+        uint16_t    minutes[MINUTE_BUCKETS];
+        uint8_t     seconds[SECOND_BUCKETS];
+        uint32_t    second_slot;    // current five second bucket since start
+        uint32_t    minute_slot;    // current minute bucket since start
+        uint16_t    sums[SALES_RATE_WINDOW_COUNT];
+    };
+
+public:
+    SalesRateTracker();
+
+    ~SalesRateTracker();
+
+    bool allocate(uint16_t shelf_count);
+
+    /**
+     * \brief Records one sale of the shelf, time in seconds.
+     */
+    void record_sale(uint16_t shelf, uint32_t time);
+
+    /**
+     * \brief Returns the number of sales in the window ending at time.
+     */
+    uint16_t sales(uint16_t shelf, SalesRateWindow window, uint32_t time);
+
+private:
+    void advance(Rates &rates, uint32_t time);
+
+private:
+    Rates       *_rates;
+    uint16_t    _size;
+};
+
+#endif /* __SALES_RATE_H__ */
@@ -0,0 +1,379 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "scenario.h"
+#include "common_setup.h"
+#include "pal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCENARIO_MAX_PROBABILITY    0xFFFFFFFFUL
+
+// Parses "HH:MM" into a time of day in ms.
+static bool parse_time(const char *text, uint32_t &time)
+{
+    unsigned int hours, minutes;
+    if (sscanf(text, "%u:%u", &hours, &minutes) != 2 || hours > 23 || minutes > 59) {
+        return false;
+    }
+    time = (hours * 60 + minutes) * 60000UL;
+    return true;
+}
+
+// Scales a demand by a percentage, within the range of the curves.
+static uint16_t scale_demand(uint32_t demand, uint32_t percent)
+{
+    uint64_t scaled = (uint64_t)demand * percent / 100;
+    if (scaled < 1) {
+        return 1;
+    }
+    return (scaled > 0xFFFF) ? 0xFFFF : (uint16_t)scaled;
+}
+
+Scenario::Scenario() : _curves(NULL), _run_starts(NULL), _run_count(0)
+{
+    set_defaults();
+}
+
+Scenario::~Scenario()
+{
+    release();
+}
+
+bool Scenario::load(uint16_t shelf_count)
+{
+    set_defaults();
+
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    palFileDescriptor_t fd;
+    if (mcc_platform_get_storage_file_path(SCENARIO_FILE_NAME, path, sizeof(path)) == 0 &&
+        pal_fsFopen(path, PAL_FS_FLAG_READONLY, &fd) == PAL_SUCCESS) {
+        char *text = (char*)malloc(SCENARIO_MAX_FILE_SIZE + 1);
+        size_t read = 0;
+        if (text != NULL && pal_fsFread(&fd, text, SCENARIO_MAX_FILE_SIZE, &read) == PAL_SUCCESS) {
+            text[read] = '\0';
+            if (parse(text)) {
+                printf("Scenario: %s\n", path);
+            } else {
+                printf("Scenario: %s is not valid, using the default scenario\n", path);
+                set_defaults();
+            }
+        }
+        free(text);
+        pal_fsFclose(&fd);
+    }
+
+    return compile(shelf_count);
+}
+
+uint16_t Scenario::capacity(uint32_t random) const
+{
+    return _capacities[((uint64_t)random * _capacity_count) >> 32];
+}
+
+uint32_t Scenario::sale_probability(uint32_t random) const
+{
+    uint64_t span = (uint64_t)(_max_probability - _min_probability) + 1;
+    return _min_probability + (uint32_t)((span * random) >> 32);
+}
+
+uint16_t Scenario::min_wait() const
+{
+    return _min_wait;
+}
+
+uint16_t Scenario::max_wait() const
+{
+    return _max_wait;
+}
+
+const uint16_t *Scenario::curve(uint16_t shelf) const
+{
+    uint16_t run = _run_count - 1;
+    while (run > 0 && _run_starts[run] > shelf) {
+        run--;
+    }
+    return _curves + (size_t)run * SCENARIO_SLOTS_PER_DAY;
+}
+
+uint32_t Scenario::restock_delay(uint64_t time) const
+{
+    if (_crew_count == 0) {
+        return _restock_ms;
+    }
+
+    // The first visit at or after the earliest restock, the table gives
+    // the first visit of its slot and the last entry wraps to the next day.
+    uint32_t earliest = (uint32_t)((time + _start_ms + _restock_ms) % SCENARIO_DAY_MS);
+    uint8_t visit = _next_crew[earliest / SCENARIO_SLOT_MS];
+    while (_crew_times[visit] < earliest) {
+        visit++;
+    }
+    return _restock_ms + _crew_times[visit] - earliest;
+}
+
+bool Scenario::parse(char *text)
+{
+    int number = 1;
+    char *line = text;
+    while (line != NULL) {
+        char *end = strchr(line, '\n');
+        if (end != NULL) {
+            *end = '\0';
+        }
+        if (!parse_line(line)) {
+            printf("Scenario: line %d not understood\n", number);
+            return false;
+        }
+        line = (end != NULL) ? end + 1 : NULL;
+        number++;
+    }
+
+    return _capacity_count > 0 && _min_wait <= _max_wait &&
+           _min_probability <= _max_probability;
+}
+
+bool Scenario::parse_line(char *line)
+{
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+
+    char keyword[16];
+    int used = 0;
+    if (sscanf(line, "%15s%n", keyword, &used) != 1) {
+        return true; // Blank line
+    }
+    const char *args = line + used;
+
+    char first[8], second[8];
+    unsigned int a, b, c;
+    if (strcmp(keyword, "start") == 0) {
+        return sscanf(args, "%7s", first) == 1 && parse_time(first, _start_ms);
+    } else if (strcmp(keyword, "capacity") == 0) {
+        // Each capacity line replaces the capacities set before.
+        char *next = (char*)args;
+        uint8_t count = 0;
+        for (;;) {
+            char *end;
+            unsigned long value = strtoul(next, &end, 10);
+            if (end == next) {
+                break;
+            }
+            if (count == SCENARIO_MAX_CAPACITIES || value == 0 || value > 0xFFFF) {
+                return false;
+            }
+            _capacities[count++] = (uint16_t)value;
+            next = end;
+        }
+        _capacity_count = count;
+        return count > 0;
+    } else if (strcmp(keyword, "conversion") == 0) {
+        if (sscanf(args, "%u %u", &a, &b) != 2 || a > 100 || b > 100) {
+            return false;
+        }
+        _min_probability = (uint32_t)((uint64_t)SCENARIO_MAX_PROBABILITY * a / 100);
+        _max_probability = (uint32_t)((uint64_t)SCENARIO_MAX_PROBABILITY * b / 100);
+        return true;
+    } else if (strcmp(keyword, "wait") == 0) {
+        if (sscanf(args, "%u %u", &a, &b) != 2 || a == 0 || b > 0xFFFF) {
+            return false;
+        }
+        _min_wait = (uint16_t)a;
+        _max_wait = (uint16_t)b;
+        return true;
+    } else if (strcmp(keyword, "demand") == 0) {
+        uint32_t time;
+        if (_demand_count == SCENARIO_SLOTS_PER_DAY ||
+            sscanf(args, "%7s %u", first, &a) != 2 || !parse_time(first, time)) {
+            return false;
+        }
+        // Keep the points sorted by time.
+        uint16_t i = _demand_count++;
+        while (i > 0 && _demand_times[i - 1] > time) {
+            _demand_times[i] = _demand_times[i - 1];
+            _demand_percents[i] = _demand_percents[i - 1];
+            i--;
+        }
+        _demand_times[i] = time;
+        _demand_percents[i] = (a > 0xFFFF) ? 0xFFFF : (uint16_t)a;
+        return true;
+    } else if (strcmp(keyword, "promotion") == 0) {
+        uint32_t start, end;
+        if (_promotion_count == SCENARIO_MAX_PROMOTIONS ||
+            sscanf(args, "%7s %7s %u %u %u", first, second, &a, &b, &c) != 5 ||
+            !parse_time(first, start) || !parse_time(second, end) ||
+            a > b || b > 0xFFFF || c > 0xFFFF) {
+            return false;
+        }
+        Promotion &promotion = _promotions[_promotion_count++];
+        promotion.start = start / SCENARIO_SLOT_MS;
+        promotion.end = end / SCENARIO_SLOT_MS;
+        promotion.first = (uint16_t)a;
+        promotion.last = (uint16_t)b;
+        promotion.percent = (uint16_t)c;
+        return true;
+    } else if (strcmp(keyword, "restock") == 0) {
+        if (sscanf(args, "%u", &a) != 1) {
+            return false;
+        }
+        _restock_ms = a;
+        return true;
+    } else if (strcmp(keyword, "crew") == 0) {
+        uint32_t time;
+        if (_crew_count == SCENARIO_MAX_CREW_VISITS ||
+            sscanf(args, "%7s", first) != 1 || !parse_time(first, time)) {
+            return false;
+        }
+        uint8_t i = _crew_count++;
+        while (i > 0 && _crew_times[i - 1] > time) {
+            _crew_times[i] = _crew_times[i - 1];
+            i--;
+        }
+        _crew_times[i] = time;
+        return true;
+    }
+
+    return false;
+}
+
+bool Scenario::compile(uint16_t shelf_count)
+{
+    release();
+
+    // Runs start at shelf 0 and wherever the set of promotions changes.
+    uint16_t starts[2 * SCENARIO_MAX_PROMOTIONS + 1];
+    uint16_t count = 0;
+    starts[count++] = 0;
+    for (uint8_t p = 0; p < _promotion_count; p++) {
+        uint32_t bounds[2] = { _promotions[p].first, (uint32_t)_promotions[p].last + 1 };
+        for (int b = 0; b < 2; b++) {
+            if (bounds[b] >= shelf_count) {
+                continue;
+            }
+            uint16_t i = count;
+            while (i > 0 && starts[i - 1] > bounds[b]) {
+                i--;
+            }
+            if (i > 0 && starts[i - 1] == bounds[b]) {
+                continue;
+            }
+            memmove(&starts[i + 1], &starts[i], (count - i) * sizeof(starts[0]));
+            starts[i] = (uint16_t)bounds[b];
+            count++;
+        }
+    }
+
+    _curves = (uint16_t*)malloc((size_t)count * SCENARIO_SLOTS_PER_DAY * sizeof(uint16_t));
+    _run_starts = (uint16_t*)malloc(count * sizeof(uint16_t));
+    if (_curves == NULL || _run_starts == NULL) {
+        printf("Failed to allocate the scenario tables\n");
+        release();
+        return false;
+    }
+    memcpy(_run_starts, starts, count * sizeof(uint16_t));
+    _run_count = count;
+
+    // Sample the daily demand curve at the start of every slot.
+    uint16_t *base = _curves;
+    for (uint32_t slot = 0; slot < SCENARIO_SLOTS_PER_DAY; slot++) {
+        uint32_t percent = 100;
+        if (_demand_count == 1) {
+            percent = _demand_percents[0];
+        } else if (_demand_count > 1) {
+            // Interpolate between the points around the slot, wrapping
+            // around midnight on either side.
+            int64_t time = (int64_t)slot * SCENARIO_SLOT_MS;
+            uint16_t next = 0;
+            while (next < _demand_count && _demand_times[next] <= time) {
+                next++;
+            }
+            uint16_t prev = (next > 0) ? next - 1 : _demand_count - 1;
+            int64_t prev_time = (int64_t)_demand_times[prev] - ((next > 0) ? 0 : SCENARIO_DAY_MS);
+            int64_t next_time = (int64_t)_demand_times[next % _demand_count] + ((next < _demand_count) ? 0 : SCENARIO_DAY_MS);
+            next %= _demand_count;
+
+            int64_t from = _demand_percents[prev];
+            int64_t to = _demand_percents[next];
+            percent = (uint32_t)(from + (to - from) * (time - prev_time) / (next_time - prev_time));
+        }
+        base[slot] = scale_demand(SCENARIO_DEMAND_UNIT, percent);
+    }
+
+    // Every run starts from the daily curve and applies its promotions.
+    for (uint16_t run = 0; run < _run_count; run++) {
+        uint16_t *curve = _curves + (size_t)run * SCENARIO_SLOTS_PER_DAY;
+        if (run > 0) {
+            memcpy(curve, base, SCENARIO_SLOTS_PER_DAY * sizeof(uint16_t));
+        }
+        for (uint8_t p = 0; p < _promotion_count; p++) {
+            const Promotion &promotion = _promotions[p];
+            if (_run_starts[run] < promotion.first || _run_starts[run] > promotion.last) {
+                continue;
+            }
+            uint32_t slot = promotion.start;
+            do {
+                curve[slot] = scale_demand(curve[slot], promotion.percent);
+                slot = (slot + 1) % SCENARIO_SLOTS_PER_DAY;
+            } while (slot != promotion.end);
+        }
+    }
+
+    // The first crew visit at or after the start of each slot.
+    if (_crew_count > 0) {
+        _crew_times[_crew_count] = _crew_times[0] + SCENARIO_DAY_MS;
+        uint8_t visit = 0;
+        for (uint32_t slot = 0; slot < SCENARIO_SLOTS_PER_DAY; slot++) {
+            while (_crew_times[visit] < slot * SCENARIO_SLOT_MS) {
+                visit++;
+            }
+            _next_crew[slot] = visit;
+        }
+    }
+
+    return true;
+}
+
+void Scenario::set_defaults()
+{
+    _start_ms = 0;
+    _capacities[0] = 10;
+    _capacities[1] = 20;
+    _capacities[2] = 30;
+    _capacity_count = 3;
+    _min_probability = 0;
+    _max_probability = SCENARIO_MAX_PROBABILITY;
+    _min_wait = 100;
+    _max_wait = 9999;
+    _restock_ms = 10000;
+    _demand_count = 0;
+    _promotion_count = 0;
+    _crew_count = 0;
+}
+
+void Scenario::release()
+{
+    free(_curves);
+    free(_run_starts);
+    _curves = NULL;
+    _run_starts = NULL;
+    _run_count = 0;
+}
@@ -0,0 +1,176 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SCENARIO_H__
+#define __SCENARIO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Name of the scenario file in the primary partition.
+#ifndef SCENARIO_FILE_NAME
+#define SCENARIO_FILE_NAME "scenario.txt"
+#endif
+
+// Largest scenario file read.
+#ifndef SCENARIO_MAX_FILE_SIZE
+#define SCENARIO_MAX_FILE_SIZE 4096
+#endif
+
+// Resolution of the demand curves and promotions.
+#ifndef SCENARIO_SLOT_MS
+#define SCENARIO_SLOT_MS (15 * 60 * 1000)
+#endif
+
+#ifndef SCENARIO_MAX_PROMOTIONS
+#define SCENARIO_MAX_PROMOTIONS 8
+#endif
+
+#ifndef SCENARIO_MAX_CREW_VISITS
+#define SCENARIO_MAX_CREW_VISITS 16
+#endif
+
+#define SCENARIO_DAY_MS             (24 * 60 * 60 * 1000)
+#define SCENARIO_SLOTS_PER_DAY      (SCENARIO_DAY_MS / SCENARIO_SLOT_MS)
+#define SCENARIO_MAX_CAPACITIES     8
+
+// Demand of 100 %, waits are divided by demand / SCENARIO_DEMAND_UNIT.
+#define SCENARIO_DEMAND_UNIT        256
+
+/**
+ * \brief Demand model of the shelf simulation.
+ *
+ *        The model is read from a text file and compiled once into flat
+ *        tables, so the engine only does table lookups while running.
+ *        Without a file the model of the original example is used: a
+ *        capacity of 10, 20 or 30, a random sale probability, a wait of
+ *        100 ms to 10 s between sales and a restock 10 s after the shelf
+ *        was found empty.
+ *
+ *        Each line of the file holds one setting, '#' starts a comment:
+ *          start HH:MM                 time of day the simulation starts at
+ *          capacity N [N ...]          capacities a shelf is given one of
+ *          conversion MIN MAX          percentage range of the sale probability
+ *          wait MIN MAX                range of the base wait between sales, ms
+ *          demand HH:MM PERCENT        point of the daily demand curve
+ *          promotion HH:MM HH:MM FIRST LAST PERCENT
+ *                                      daily demand boost of shelves FIRST..LAST
+ *          restock MS                  least delay of a restock
+ *          crew HH:MM                  visit of the restock crew
+ *
+ *        The demand curve interpolates linearly between its points and
+ *        wraps around midnight, a higher demand shortens the waits between
+ *        sales. Promotions multiply the curve of their shelves. Both are
+ *        sampled every SCENARIO_SLOT_MS: every run of shelves covered by
+ *        the same promotions shares one curve of SCENARIO_SLOTS_PER_DAY
+ *        entries. With crew visits an empty shelf waits for the next visit
+ *        at least restock ms away.
+ */
+class Scenario
+{
+    struct Promotion {
+        uint32_t    start;  // slot
+        uint32_t    end;    // slot, exclusive
+        uint16_t    first;
+        uint16_t    last;
+        uint16_t    percent;
+    };
+
+public:
+    Scenario();
+
+    ~Scenario();
+
+    /**
+     * \brief Reads and compiles the scenario file, or the default model if
+     *        there is no file or it is not valid.
+     *
+     * \return false if the tables could not be allocated.
+     */
+    bool load(uint16_t shelf_count);
+
+    /**
+     * \brief Returns the capacity picked by a random number.
+     */
+    uint16_t capacity(uint32_t random) const;
+
+    /**
+     * \brief Returns the sale probability picked by a random number.
+     */
+    uint32_t sale_probability(uint32_t random) const;
+
+    uint16_t min_wait() const;
+    uint16_t max_wait() const;
+
+    /**
+     * \brief Returns the demand curve of a shelf, for wait().
+     */
+    const uint16_t *curve(uint16_t shelf) const;
+
+    /**
+     * \brief Scales a base wait by the demand of the curve at the given
+     *        simulation time.
+     */
+    uint32_t wait(const uint16_t *curve, uint64_t time, uint16_t base) const;
+
+    /**
+     * \brief Returns the delay of the restock of a shelf found empty at the
+     *        given simulation time.
+     */
+    uint32_t restock_delay(uint64_t time) const;
+
+private:
+    bool parse(char *text);
+    bool parse_line(char *line);
+    bool compile(uint16_t shelf_count);
+    void set_defaults();
+    void release();
+
+private:
+    uint32_t    _start_ms;
+    uint16_t    _capacities[SCENARIO_MAX_CAPACITIES];
+    uint8_t     _capacity_count;
+    uint32_t    _min_probability;
+    uint32_t    _max_probability;
+    uint16_t    _min_wait;
+    uint16_t    _max_wait;
+    uint32_t    _restock_ms;
+
+    // Settings only used while compiling.
+    uint32_t    _demand_times[SCENARIO_SLOTS_PER_DAY];
+    uint16_t    _demand_percents[SCENARIO_SLOTS_PER_DAY];
+    uint16_t    _demand_count;
+    Promotion   _promotions[SCENARIO_MAX_PROMOTIONS];
+    uint8_t     _promotion_count;
+
+    // Compiled tables.
+    uint16_t    *_curves;       // SCENARIO_SLOTS_PER_DAY entries per run
+    uint16_t    *_run_starts;   // first shelf of each run
+    uint16_t    _run_count;
+    uint32_t    _crew_times[SCENARIO_MAX_CREW_VISITS + 1];
+    uint8_t     _crew_count;
+    uint8_t     _next_crew[SCENARIO_SLOTS_PER_DAY];
+};
+
+inline uint32_t Scenario::wait(const uint16_t *curve, uint64_t time, uint16_t base) const
+{
+    uint32_t slot = (uint32_t)(((time + _start_ms) / SCENARIO_SLOT_MS) % SCENARIO_SLOTS_PER_DAY);
+    return (uint32_t)base * SCENARIO_DEMAND_UNIT / curve[slot];
+}
+
+#endif /* __SCENARIO_H__ */
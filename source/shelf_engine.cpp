@@ -0,0 +1,1097 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "shelf_engine.h"
+#include "simplem2mclient.h"
+
+#include "nanostack-event-loop/eventOS_event.h"
+#include "nanostack-event-loop/eventOS_event_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (TARGET_LIKE_MBED) && defined (MBED_HEAP_STATS_ENABLED)
+#include "mbed_stats.h"
+#elif defined (__linux__)
+#include <malloc.h>
+#endif
+
+#define SHELF_ENGINE_TASKLET_INIT_EVENT 0
+#define SHELF_ENGINE_TASKLET_DRAIN      10
+
+// Shards are aligned to this many shelves so that two workers never write
+// the same cache line of a uint16_t store column.
+#define SHELF_ENGINE_SHARD_ALIGN        32
+
+// The drain tasklet lives as long as the event loop, which outlives the
+// engine, so it finds the engine through these under drain_mutex.
+static int8_t drain_tasklet = -1;
+static palMutexID_t drain_mutex;
+static arm_event_storage_t *drain_event = NULL;
+static ShelfEngine *drain_engine = NULL;
+static SimpleM2MClient *drain_client = NULL;
+
+// Appends an unsigned integer to a CBOR item, in its shortest form.
+static size_t write_cbor_uint(uint8_t *buffer, uint32_t value)
+{
+    if (value < 24) {
+        buffer[0] = (uint8_t)value;
+        return 1;
+    } else if (value <= 0xFF) {
+        buffer[0] = 0x18;
+        buffer[1] = (uint8_t)value;
+        return 2;
+    } else if (value <= 0xFFFF) {
+        buffer[0] = 0x19;
+        buffer[1] = (uint8_t)(value >> 8);
+        buffer[2] = (uint8_t)value;
+        return 3;
+    }
+    buffer[0] = 0x1A;
+    buffer[1] = (uint8_t)(value >> 24);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 8);
+    buffer[4] = (uint8_t)value;
+    return 5;
+}
+
+// Returns the amount of heap currently in use, or 0 if the platform
+// cannot tell.
+static size_t heap_in_use()
+{
+#if defined (TARGET_LIKE_MBED) && defined (MBED_HEAP_STATS_ENABLED)
+    mbed_stats_heap_t stats;
+    mbed_stats_heap_get(&stats);
+    return stats.current_size;
+#elif defined (__linux__) && defined (__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#elif defined (__linux__)
+    struct mallinfo info = mallinfo();
+    return (size_t)info.uordblks + (size_t)info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+ShelfEngine::ShelfEngine() : _start(0), _log_mode(SALE_LOG_MODE),
+    _journal_enabled(SHELF_JOURNAL_ENABLED && SALE_LOG_MODE != SALE_LOG_MODE_REPLAY), _restored(false),
+    _offline_since(0), _published_time(0), _offline_changes(NULL), _registered(false),
+    _last_stats(0), _last_flush(0), _last_checkpoint(0), _last_history(0), _update_count(0), _traffic_count(0),
+    _publish_cb(NULL), _publish_context(NULL),
+    _shards(NULL), _shard_count(0), _worker_count(0), _stopping(0),
+    _shelves(NULL), _dirty(NULL), _dirty_count(0), _shelf_count(0), _heap_used(0)
+{
+    memset(&_replay_timer, 0, sizeof(_replay_timer));
+}
+
+ShelfEngine::~ShelfEngine()
+{
+    for (uint16_t i = 0; i < _shard_count; i++) {
+        delete _shards[i].wheel;
+    }
+    delete[] _shards;
+    delete[] _shelves;
+    delete[] _dirty;
+}
+
+bool ShelfEngine::create_shelves(SimpleM2MClient &client, uint16_t shelf_count, uint16_t worker_count)
+{
+    size_t heap_before = heap_in_use();
+
+    // The sale log is written and read in time order by a single shard.
+    _worker_count = (_log_mode == SALE_LOG_MODE_OFF) ? worker_count : 0;
+    _shard_count = (_worker_count > 0) ? _worker_count : 1;
+
+    _shards = new Shard[_shard_count]();
+    _shelves = new Shelf[shelf_count]();
+    if (SHELF_ENGINE_STATE_RESOURCE) {
+        _dirty = new uint16_t[shelf_count];
+    }
+    if (_shards == NULL || _shelves == NULL || (SHELF_ENGINE_STATE_RESOURCE && _dirty == NULL) ||
+        !_store.allocate(shelf_count) || !_rates.allocate(shelf_count) ||
+        !_notifications.allocate((uint32_t)shelf_count * SHELF_NOTICE_COUNT)) {
+        printf("Failed to allocate %d shelves\n", shelf_count);
+        return false;
+    }
+    _shelf_count = shelf_count;
+    _catalog.load();
+    if (!_scenario.load(shelf_count)) {
+        return false;
+    }
+
+    // Split the shelves into contiguous shards of aligned size.
+    uint32_t per_shard = (shelf_count + _shard_count - 1) / _shard_count;
+    per_shard = (per_shard + SHELF_ENGINE_SHARD_ALIGN - 1) & ~(uint32_t)(SHELF_ENGINE_SHARD_ALIGN - 1);
+    for (uint16_t i = 0; i < _shard_count; i++) {
+        Shard &shard = _shards[i];
+        uint32_t begin = i * per_shard;
+        uint32_t end = begin + per_shard;
+
+        shard.engine = this;
+        shard.begin = (uint16_t)((begin < shelf_count) ? begin : shelf_count);
+        shard.end = (uint16_t)((end < shelf_count) ? end : shelf_count);
+
+        // The wheel is allocated as it is too large for the main thread stack.
+        shard.wheel = new TimingWheel();
+        if (shard.wheel == NULL || (_worker_count > 0 && !shard.queue.allocate(SHELF_ENGINE_QUEUE_SIZE))) {
+            printf("Failed to allocate %d shelves\n", shelf_count);
+            return false;
+        }
+    }
+
+    for (uint16_t i = 0; i < _shelf_count; i++) {
+        Shelf &shelf = _shelves[i];
+
+        shelf.product_id = client.add_cloud_resource(SHELF_OBJECT_ID, i, SHELF_RESOURCE_PRODUCT_ID,
+                                  "product_id", M2MResourceInstance::STRING,
+                                  M2MBase::GET_ALLOWED, 0, false, NULL, NULL);
+
+        shelf.current_count = client.add_cloud_resource(SHELF_OBJECT_ID, i, SHELF_RESOURCE_CURRENT_COUNT,
+                                  "product_current_count", M2MResourceInstance::INTEGER,
+                                  M2MBase::GET_ALLOWED, 0, SHELF_ENGINE_OBSERVE_FIELDS, NULL, NULL);
+
+        shelf.empty = client.add_cloud_resource(SHELF_OBJECT_ID, i, SHELF_RESOURCE_EMPTY,
+                                  "product_empty", M2MResourceInstance::INTEGER,
+                                  M2MBase::GET_ALLOWED, 0, SHELF_ENGINE_OBSERVE_FIELDS, NULL, NULL);
+
+        shelf.sales[SALES_RATE_1_MIN] = client.add_cloud_resource(SHELF_OBJECT_ID, i, SHELF_RESOURCE_SALES_1_MIN,
+                                  "sales_1_min", M2MResourceInstance::INTEGER,
+                                  M2MBase::GET_ALLOWED, 0, SHELF_ENGINE_OBSERVE_FIELDS, NULL, NULL);
+
+        shelf.sales[SALES_RATE_15_MIN] = client.add_cloud_resource(SHELF_OBJECT_ID, i, SHELF_RESOURCE_SALES_15_MIN,
+                                  "sales_15_min", M2MResourceInstance::INTEGER,
+                                  M2MBase::GET_ALLOWED, 0, SHELF_ENGINE_OBSERVE_FIELDS, NULL, NULL);
+
+        shelf.sales[SALES_RATE_1_HOUR] = client.add_cloud_resource(SHELF_OBJECT_ID, i, SHELF_RESOURCE_SALES_1_HOUR,
+                                  "sales_1_hour", M2MResourceInstance::INTEGER,
+                                  M2MBase::GET_ALLOWED, 0, SHELF_ENGINE_OBSERVE_FIELDS, NULL, NULL);
+
+        if (SHELF_ENGINE_STATE_RESOURCE) {
+            shelf.state_resource = client.add_cloud_resource(SHELF_OBJECT_ID, i, SHELF_RESOURCE_STATE,
+                                      "shelf_state", M2MResourceInstance::OPAQUE,
+                                      M2MBase::GET_ALLOWED, 0, true, NULL, NULL);
+        }
+
+        // Hand the resources to the queue in the order of notice().
+        bool queued = _notifications.add(shelf.current_count) == notice(i, SHELF_UPDATE_COUNT) &&
+                      _notifications.add(shelf.empty) == notice(i, SHELF_UPDATE_EMPTY);
+        for (int window = 0; window < SALES_RATE_WINDOW_COUNT; window++) {
+            queued = queued && _notifications.add(shelf.sales[window]) == notice(i, SHELF_UPDATE_SALES + window);
+        }
+        if (SHELF_ENGINE_STATE_RESOURCE) {
+            queued = queued && _notifications.add(shelf.state_resource, 1 + (2 + SALES_RATE_WINDOW_COUNT) * 5) ==
+                     notice(i, SHELF_NOTICE_STATE);
+        }
+        if (!queued) {
+            printf("Failed to allocate %d shelves\n", shelf_count);
+            return false;
+        }
+
+        shelf.timer.data = &shelf;
+        shelf.state = SHELF_STATE_IDLE;
+    }
+
+    _gateway.load(client, _shelf_count);
+
+    _offline_changes = client.add_cloud_resource(SHELF_OFFLINE_OBJECT_ID, 0, SHELF_OFFLINE_RESOURCE_CHANGES,
+                              "offline_changes", M2MResourceInstance::OPAQUE,
+                              M2MBase::GET_ALLOWED, 0, true, NULL, NULL);
+
+    size_t heap_after = heap_in_use();
+    _heap_used = (heap_after > heap_before) ? (heap_after - heap_before) : 0;
+
+    return true;
+}
+
+bool ShelfEngine::restore()
+{
+    if (!_journal_enabled) {
+        return false;
+    }
+
+    uint64_t started = SimClock::real_now();
+    ShelfJournalState *states = (ShelfJournalState*)malloc(_shelf_count * sizeof(ShelfJournalState));
+    if (states == NULL || !_journal.load(states, _shelf_count)) {
+        free(states);
+        return false;
+    }
+
+    if (!match_devices(states)) {
+        free(states);
+        return false;
+    }
+
+    for (uint16_t i = 0; i < _shelf_count; i++) {
+        if (states[i].product >= _catalog.count()) {
+            printf("Shelf journal: product %d of shelf %d is not in the catalog\n", states[i].product, i);
+            free(states);
+            return false;
+        }
+    }
+
+    // The client is not registered yet, so setting the values does not
+    // notify anything and the first registration carries the real state.
+    for (uint16_t i = 0; i < _shelf_count; i++) {
+        Shelf &shelf = _shelves[i];
+        const ShelfJournalState &state = states[i];
+
+        shelf.sale_prob = state.sale_prob;
+        _store.set_capacity(i, state.capacity);
+        set_product(shelf, state.product);
+        set_count(shelf, state.count);
+        _store.set_empty(i, state.empty);
+        _store.commit(i);
+        shelf.current_count->set_value(_store.count(i));
+        shelf.empty->set_value(_store.empty(i));
+        _store.set_published_count(i, _store.count(i));
+        _store.set_published_empty(i, _store.empty(i));
+        if (SHELF_ENGINE_STATE_RESOURCE) {
+            publish_state(i);
+        }
+    }
+    free(states);
+
+    _restored = true;
+    printf("Restored %d shelves in %lu ms\n", _shelf_count,
+           (unsigned long)(SimClock::real_now() - started));
+    return true;
+}
+
+static int compare_devices(const void *a, const void *b)
+{
+    uint32_t first = ((const ShelfJournalState*)a)->device;
+    uint32_t second = ((const ShelfJournalState*)b)->device;
+    return (first < second) ? -1 : (first > second) ? 1 : 0;
+}
+
+bool ShelfEngine::match_devices(ShelfJournalState *states)
+{
+    uint16_t moved = 0;
+    for (uint16_t i = 0; i < _shelf_count; i++) {
+        if (states[i].device != _gateway.device(i)) {
+            moved++;
+        }
+    }
+    if (moved == 0) {
+        return true;
+    }
+
+    // The device list changed since the checkpoint, give every bridged
+    // device its own state back and the other shelves the unbridged states
+    // in their order. The log is not used again as start() checkpoints the
+    // reordered state.
+    ShelfJournalState *saved = (ShelfJournalState*)malloc(_shelf_count * sizeof(ShelfJournalState));
+    if (saved == NULL) {
+        printf("Shelf journal: failed to allocate the reordered state\n");
+        return false;
+    }
+    memcpy(saved, states, _shelf_count * sizeof(ShelfJournalState));
+    qsort(saved, _shelf_count, sizeof(ShelfJournalState), compare_devices);
+
+    uint16_t unbridged = 0;
+    for (uint16_t i = 0; i < _shelf_count; i++) {
+        ShelfJournalState key;
+        key.device = _gateway.device(i);
+        if (key.device == 0) {
+            if (unbridged == _shelf_count || saved[unbridged].device != 0) {
+                printf("Shelf journal: more shelves bridge no device than saved, not restoring\n");
+                free(saved);
+                return false;
+            }
+            states[i] = saved[unbridged++];
+            continue;
+        }
+
+        const ShelfJournalState *match = (const ShelfJournalState*)bsearch(&key, saved, _shelf_count,
+                                                   sizeof(ShelfJournalState), compare_devices);
+        if (match == NULL) {
+            printf("Shelf journal: no saved state for the device of shelf %d, not restoring\n", i);
+            free(saved);
+            return false;
+        }
+        states[i] = *match;
+    }
+    free(saved);
+
+    printf("Shelf journal: %d shelves bridge another device than saved, restored by device\n", moved);
+    return true;
+}
+
+void ShelfEngine::start(uint64_t seed, uint32_t time_scale)
+{
+    for (uint16_t i = 0; i < _shard_count; i++) {
+        Shard &shard = _shards[i];
+        shard.clock.start(time_scale);
+        shard.now = shard.clock.now();
+        shard.wheel->reset(shard.now);
+        shard.wheel->insert(shard.rate_timer, shard.now + SHELF_ENGINE_RATE_INTERVAL_MS);
+    }
+    _start = _shards[0].now;
+
+    if (SHELF_HISTORY_ENABLED) {
+        _history.open(_shelf_count);
+    }
+
+    if (_log_mode == SALE_LOG_MODE_REPLAY) {
+        if (start_replay()) {
+            return;
+        }
+        printf("Sale log replay failed, simulating instead\n");
+        _log_mode = SALE_LOG_MODE_OFF;
+    } else if (_log_mode == SALE_LOG_MODE_RECORD) {
+        if (!_log.open_for_record(_shelf_count)) {
+            _log_mode = SALE_LOG_MODE_OFF;
+        }
+    }
+
+    SimRandom streams(seed);
+    for (uint16_t s = 0; s < _shard_count; s++) {
+        Shard &shard = _shards[s];
+
+        for (uint16_t i = shard.begin; i < shard.end; i++) {
+            Shelf &shelf = _shelves[i];
+
+            shelf.random = streams;
+            streams.jump();
+            shelf.demand = _scenario.curve(i);
+            shelf.next_delay = SHELF_ENGINE_DELAY_BATCH;
+
+            if (_restored) {
+                if (_log_mode == SALE_LOG_MODE_RECORD) {
+                    // Give the log the state it starts from.
+                    _log.append(0, i, SALE_LOG_EVENT_PRODUCT, _store.product(i));
+                    _log.append(0, i, SALE_LOG_EVENT_COUNT, _store.count(i));
+                    _log.append(0, i, SALE_LOG_EVENT_EMPTY, _store.empty(i));
+                }
+            } else {
+                _store.set_capacity(i, _scenario.capacity(shelf.random.next()));
+                shelf.sale_prob = _scenario.sale_probability(shelf.random.next());
+
+                // Set a product ID
+                set_product(shelf, shelf.random.below(_catalog.count()));
+                set_count(shelf, _store.capacity(i));
+                commit(shard, shelf);
+            }
+
+            schedule(shard, shelf, SHELF_STATE_WAIT_SALE, sale_delay(shard, shelf));
+        }
+    }
+
+    // Start the journal from the current state, which also compacts the
+    // log of a restored run.
+    checkpoint();
+}
+
+void ShelfEngine::run(SimpleM2MClient &client)
+{
+    _last_stats = SimClock::real_now();
+    _last_flush = _last_stats;
+    _last_checkpoint = _last_stats;
+    _last_history = _last_stats;
+    _registered = true;
+
+    if (_worker_count > 0) {
+        // The workers simulate and the event loop publishes, wait for the end.
+        if (start_workers(client)) {
+            while (client.is_register_called()) {
+                mcc_platform_do_wait(SHELF_ENGINE_MAX_WAIT_MS);
+            }
+        } else {
+            printf("Failed to start the shelf workers\n");
+        }
+        stop_workers();
+    } else {
+        // Check if client is registering or registered, if true run the
+        // shelves which are due, sleep until the next deadline and repeat.
+        Shard &shard = _shards[0];
+        while (client.is_register_called()) {
+            uint64_t now = shard.clock.now();
+            shard.wheel->advance(now, timer_expired, &shard);
+
+            service(client);
+
+            uint64_t next = shard.wheel->next_event();
+            if (next == TimingWheel::NO_EVENT) {
+                next = now + SHELF_ENGINE_MAX_WAIT_MS;
+            }
+            shard.clock.wait_until(next, SHELF_ENGINE_MAX_WAIT_MS);
+        }
+    }
+
+    _log.close();
+    _offline.close();
+    _history.close();
+    if (_journal_enabled) {
+        checkpoint();
+        _journal.close();
+    }
+
+    print_statistics();
+    uint64_t real_elapsed = _shards[0].clock.real_elapsed();
+    printf("Simulated %lu s in %lu s\n",
+           (unsigned long)(_shards[0].clock.virtual_elapsed() / 1000),
+           (unsigned long)(real_elapsed / 1000));
+    printf("Published %lu updates from %d shards, %lu updates/s\n",
+           (unsigned long)_update_count, _shard_count,
+           (unsigned long)(real_elapsed ? _update_count * 1000 / real_elapsed : 0));
+}
+
+uint16_t ShelfEngine::shelf_count() const
+{
+    return _shelf_count;
+}
+
+void ShelfEngine::set_publish_callback(publish_cb cb, void *context)
+{
+    _publish_cb = cb;
+    _publish_context = context;
+}
+
+void ShelfEngine::print_memory_stats() const
+{
+    printf("*** Shelf engine memory ***\n");
+    printf("shelves              : %d\n", _shelf_count);
+    printf("shards               : %d\n", _shard_count);
+    printf("bridged devices      : %d\n", _gateway.bridged_count());
+    printf("engine state / shelf : %u\n", (unsigned int)sizeof(Shelf));
+    if (_heap_used > 0 && _shelf_count > 0) {
+        printf("heap used            : %lu\n", (unsigned long)_heap_used);
+        printf("heap used / shelf    : %lu\n", (unsigned long)(_heap_used / _shelf_count));
+    } else {
+        printf("heap used            : not available\n");
+    }
+    printf("***************************\n");
+}
+
+void ShelfEngine::print_statistics() const
+{
+    uint16_t low[8];
+    uint32_t low_count = _store.find_low_stock(low, sizeof(low) / sizeof(low[0]));
+
+    printf("Stock: %lu items, %lu empty shelves, %lu shelves low on stock",
+           (unsigned long)_store.total_count(), (unsigned long)_store.empty_count(),
+           (unsigned long)low_count);
+    if (low_count > 0) {
+        printf(" (");
+        for (uint32_t i = 0; i < low_count && i < sizeof(low) / sizeof(low[0]); i++) {
+            printf("%s%d", i ? ", " : "", low[i]);
+        }
+        printf("%s)", low_count > sizeof(low) / sizeof(low[0]) ? ", ..." : "");
+    }
+    printf("\n");
+    _notifications.print_statistics();
+}
+
+void ShelfEngine::schedule(Shard &shard, Shelf &shelf, ShelfState state, uint32_t delay_ms)
+{
+    // Deadlines are relative to the step being run rather than to the wall
+    // clock, so a late wakeup does not shift the rest of the timeline.
+    shelf.state = state;
+    shard.wheel->insert(shelf.timer, shard.now + delay_ms);
+}
+
+void ShelfEngine::process(Shard &shard, Shelf &shelf)
+{
+    uint16_t i = index(shelf);
+
+    switch (shelf.state) {
+        case SHELF_STATE_WAIT_SALE:
+            if (_store.empty(i)) {
+                schedule(shard, shelf, SHELF_STATE_WAIT_RESTOCK, _scenario.restock_delay(shard.now - _start));
+            } else {
+                sell(shard, shelf);
+            }
+            break;
+        case SHELF_STATE_WAIT_RESTOCK:
+            set_count(shelf, _store.capacity(i)); // Restock
+            _store.set_empty(i, 0);
+            sell(shard, shelf);
+            break;
+        case SHELF_STATE_WAIT_UNSALE:
+            set_count(shelf, _store.count(i) + 1);
+            finish_tick(shard, shelf);
+            break;
+        default:
+            break;
+    }
+}
+
+void ShelfEngine::sell(Shard &shard, Shelf &shelf)
+{
+    uint16_t i = index(shelf);
+
+    set_count(shelf, _store.count(i) - 1);
+    //Sold
+    if (shelf.random.next() < shelf.sale_prob) {
+        record_sale(shard, i);
+        finish_tick(shard, shelf);
+    } else {
+        schedule(shard, shelf, SHELF_STATE_WAIT_UNSALE, 1000);
+    }
+}
+
+void ShelfEngine::finish_tick(Shard &shard, Shelf &shelf)
+{
+    uint16_t i = index(shelf);
+
+    if (_store.count(i) == 0) {
+        _store.set_empty(i, 1);
+    }
+    commit(shard, shelf);
+    schedule(shard, shelf, SHELF_STATE_WAIT_SALE, sale_delay(shard, shelf));
+}
+
+uint32_t ShelfEngine::sale_delay(Shard &shard, Shelf &shelf)
+{
+    if (shelf.next_delay >= SHELF_ENGINE_DELAY_BATCH) {
+        // Random base waits, 100 ms to 10 s by default
+        shelf.random.fill_range(shelf.delays, SHELF_ENGINE_DELAY_BATCH,
+                                _scenario.min_wait(), _scenario.max_wait());
+        shelf.next_delay = 0;
+    }
+    return _scenario.wait(shelf.demand, shard.now - _start, shelf.delays[shelf.next_delay++]);
+}
+
+uint16_t ShelfEngine::index(const Shelf &shelf) const
+{
+    return (uint16_t)(&shelf - _shelves);
+}
+
+void ShelfEngine::set_product(Shelf &shelf, uint32_t product)
+{
+    // Products only change while a single thread runs the engine, before
+    // the workers start or when replaying the sale log.
+    const uint8_t *name;
+    uint8_t length;
+    if (!_catalog.name(product, name, length)) {
+        return;
+    }
+    shelf.product_id->set_value(name, length);
+    _store.set_product(index(shelf), (uint16_t)product);
+
+    uint64_t time = _shards[0].now - _start;
+    if (_log_mode == SALE_LOG_MODE_RECORD) {
+        _log.append(time, index(shelf), SALE_LOG_EVENT_PRODUCT, product);
+    }
+    log_change(time, index(shelf), SHELF_JOURNAL_PRODUCT, product);
+}
+
+void ShelfEngine::set_count(Shelf &shelf, int32_t count)
+{
+    _store.set_count(index(shelf), (count < 0) ? 0 : (uint16_t)count);
+}
+
+void ShelfEngine::commit(Shard &shard, Shelf &shelf)
+{
+    uint16_t i = index(shelf);
+    uint16_t count = _store.count(i);
+    uint8_t empty = _store.empty(i);
+
+    // Publish only what changed since the last commit of this shelf.
+    if (count != _store.committed_count(i)) {
+        emit(shard, i, SHELF_UPDATE_COUNT, count, (int32_t)count - _store.committed_count(i));
+    }
+    if (empty != _store.committed_empty(i)) {
+        emit(shard, i, SHELF_UPDATE_EMPTY, empty, 0);
+    }
+    _store.commit(i);
+}
+
+void ShelfEngine::record_sale(Shard &shard, uint16_t shelf)
+{
+    uint32_t time = (uint32_t)((shard.now - _start) / 1000);
+    _store.set_last_sale(shelf, time);
+    _rates.record_sale(shelf, time);
+}
+
+void ShelfEngine::refresh_rates(Shard &shard)
+{
+    uint32_t time = (uint32_t)((shard.now - _start) / 1000);
+
+    for (uint16_t i = shard.begin; i < shard.end; i++) {
+        Shelf &shelf = _shelves[i];
+        for (int window = 0; window < SALES_RATE_WINDOW_COUNT; window++) {
+            uint16_t sales = _rates.sales(i, (SalesRateWindow)window, time);
+            if (sales != shelf.published_sales[window]) {
+                emit(shard, i, SHELF_UPDATE_SALES + window, sales, 0);
+                shelf.published_sales[window] = sales;
+            }
+        }
+    }
+
+    shard.wheel->insert(shard.rate_timer, shard.now + SHELF_ENGINE_RATE_INTERVAL_MS);
+}
+
+void ShelfEngine::emit(Shard &shard, uint16_t shelf, uint8_t field, uint32_t value, int32_t delta)
+{
+    ShelfUpdate update;
+    update.time = shard.now - _start;
+    update.delta = delta;
+    update.value = value;
+    update.made_us = _publish_cb ? (uint32_t)SimClock::real_now_us() : 0;
+    update.shelf = shelf;
+    update.field = field;
+
+    if (!shard.threaded) {
+        // Give the client time to acknowledge, up to the longest wait since
+        // the shard was first held back. After that the values are coalesced
+        // until the client catches up, instead of waiting again every time.
+        NotificationPolicy policy = (NotificationPolicy)SHELF_ENGINE_NOTIFICATION_POLICY;
+        for (bool retry = false; !publish(update, policy); retry = true) {
+            uint64_t now = SimClock::real_now();
+            if (!shard.blocked) {
+                shard.blocked = true;
+                shard.hold_since = now;
+            } else if (now - shard.hold_since >= SHELF_ENGINE_MAX_WAIT_MS) {
+                policy = NOTIFICATION_POLICY_COALESCE;
+                continue;
+            }
+            _notifications.pump();
+            if (retry) {
+                pal_osDelay(1);
+            }
+        }
+        if (policy != NOTIFICATION_POLICY_COALESCE) {
+            shard.blocked = false;
+        }
+        return;
+    }
+
+    while (!shard.queue.push(update)) {
+        // The event loop is behind, let it catch up.
+        pal_osDelay(1);
+    }
+}
+
+bool ShelfEngine::publish(const ShelfUpdate &update, NotificationPolicy policy)
+{
+    Shelf &shelf = _shelves[update.shelf];
+
+    // Empty flags are critical and always taken. A dropped value is still
+    // journaled and part of the state resource.
+    if (update.field != SHELF_UPDATE_EMPTY &&
+        _notifications.set(notice(update.shelf, update.field), update.value,
+                           NOTIFICATION_PRIORITY_BULK, policy) == NOTIFICATION_BLOCKED) {
+        return false;
+    }
+
+    if (update.time > _published_time) {
+        _published_time = update.time;
+    }
+    _update_count++;
+
+    switch (update.field) {
+        case SHELF_UPDATE_COUNT:
+            _store.set_published_count(update.shelf, (uint16_t)update.value);
+            if (_log_mode == SALE_LOG_MODE_RECORD) {
+                _log.append(update.time, update.shelf, SALE_LOG_EVENT_COUNT, update.delta);
+            }
+            log_change(update.time, update.shelf, SHELF_JOURNAL_COUNT, update.value);
+            _history.append(update.time, update.shelf, (uint16_t)update.value);
+            break;
+        case SHELF_UPDATE_EMPTY:
+            _notifications.set(notice(update.shelf, update.field), update.value, NOTIFICATION_PRIORITY_CRITICAL);
+            shelf.state_edge = true;
+            _store.set_published_empty(update.shelf, (uint8_t)update.value);
+            if (_log_mode == SALE_LOG_MODE_RECORD) {
+                _log.append(update.time, update.shelf, SALE_LOG_EVENT_EMPTY, update.value);
+            }
+            log_change(update.time, update.shelf, SHELF_JOURNAL_EMPTY, update.value);
+            break;
+        default:
+            shelf.reported_sales[update.field - SHELF_UPDATE_SALES] = (uint16_t)update.value;
+            break;
+    }
+
+    if (SHELF_ENGINE_STATE_RESOURCE && !shelf.state_dirty) {
+        shelf.state_dirty = true;
+        _dirty[_dirty_count++] = update.shelf;
+    }
+
+    if (_publish_cb) {
+        _publish_cb((uint32_t)SimClock::real_now_us() - update.made_us, _publish_context);
+    }
+    return true;
+}
+
+void ShelfEngine::service(SimpleM2MClient &client)
+{
+    if (client.is_client_registered() != _registered) {
+        connection_changed(client.is_client_registered());
+    }
+
+    drain();
+
+    // Let a registration update that is almost due go with the notifications.
+    if (_update_count != _traffic_count) {
+        _traffic_count = _update_count;
+        client.traffic_sent();
+    }
+
+    uint64_t real_now = SimClock::real_now();
+#if SHELF_ENGINE_STATS_INTERVAL_MS > 0
+    if (real_now - _last_stats >= SHELF_ENGINE_STATS_INTERVAL_MS) {
+        print_statistics();
+        _last_stats = real_now;
+    }
+#endif
+
+    if (_journal_enabled) {
+        if (_journal.log_size() >= SHELF_JOURNAL_WAL_LIMIT ||
+            (SHELF_JOURNAL_CHECKPOINT_INTERVAL_MS > 0 &&
+             real_now - _last_checkpoint >= SHELF_JOURNAL_CHECKPOINT_INTERVAL_MS)) {
+            checkpoint();
+            _last_checkpoint = real_now;
+            _last_flush = real_now;
+        } else if (real_now - _last_flush >= SHELF_JOURNAL_FLUSH_INTERVAL_MS) {
+            _journal.flush();
+            _last_flush = real_now;
+        }
+    }
+
+    // Write the history of quiet stores too, not only when a block fills up.
+    if (real_now - _last_history >= SHELF_HISTORY_FLUSH_INTERVAL_MS) {
+        _history.flush();
+        _last_history = real_now;
+    }
+}
+
+void ShelfEngine::drain()
+{
+    // Take at most one queue worth from each shard, so that busy workers
+    // cannot keep the event loop here forever.
+    for (uint16_t s = 0; s < _shard_count; s++) {
+        Shard &shard = _shards[s];
+        NotificationPolicy policy = (NotificationPolicy)SHELF_ENGINE_NOTIFICATION_POLICY;
+        if (shard.holding) {
+            // Like emit(), stop holding the shard back once the client has
+            // not made room for the longest wait.
+            if (SimClock::real_now() - shard.hold_since >= SHELF_ENGINE_MAX_WAIT_MS) {
+                policy = NOTIFICATION_POLICY_COALESCE;
+            }
+            if (!publish(shard.held, policy)) {
+                continue;
+            }
+            shard.holding = false;
+        }
+        ShelfUpdate update;
+        for (uint32_t n = 0; n < SHELF_ENGINE_QUEUE_SIZE && shard.queue.pop(update); n++) {
+            if (publish(update, policy)) {
+                continue;
+            }
+            // Send what the window allows and try once more, otherwise the
+            // shard waits for the next drain with its queue filling up.
+            _notifications.pump();
+            if (!publish(update, policy)) {
+                shard.held = update;
+                shard.hold_since = SimClock::real_now();
+                shard.holding = true;
+                break;
+            }
+        }
+    }
+
+    publish_states();
+    _notifications.pump();
+}
+
+void ShelfEngine::publish_state(uint16_t shelf)
+{
+    Shelf &state = _shelves[shelf];
+
+    uint8_t payload[1 + (2 + SALES_RATE_WINDOW_COUNT) * 5];
+    size_t length = 0;
+    payload[length++] = 0x80 | (2 + SALES_RATE_WINDOW_COUNT);  // array
+    length += write_cbor_uint(payload + length, _store.published_count(shelf));
+    length += write_cbor_uint(payload + length, _store.published_empty(shelf));
+    for (int window = 0; window < SALES_RATE_WINDOW_COUNT; window++) {
+        length += write_cbor_uint(payload + length, state.reported_sales[window]);
+    }
+    _notifications.set(notice(shelf, SHELF_NOTICE_STATE), payload, (uint16_t)length,
+                       state.state_edge ? NOTIFICATION_PRIORITY_CRITICAL : NOTIFICATION_PRIORITY_BULK);
+    state.state_edge = false;
+}
+
+void ShelfEngine::publish_states()
+{
+    // One notification per changed shelf, whatever number of its fields
+    // changed in this batch.
+    for (uint16_t i = 0; i < _dirty_count; i++) {
+        _shelves[_dirty[i]].state_dirty = false;
+        publish_state(_dirty[i]);
+    }
+    _dirty_count = 0;
+}
+
+uint32_t ShelfEngine::notice(uint16_t shelf, uint8_t field) const
+{
+    return (uint32_t)shelf * SHELF_NOTICE_COUNT + field;
+}
+
+void ShelfEngine::checkpoint()
+{
+    if (!_journal_enabled || !_journal.begin_checkpoint(_shelf_count)) {
+        return;
+    }
+
+    // Capacities, products and sale probabilities only change before the
+    // workers start, counts are taken as published.
+    for (uint16_t i = 0; i < _shelf_count; i++) {
+        ShelfJournalState state;
+        state.device = _gateway.device(i);
+        state.sale_prob = _shelves[i].sale_prob;
+        state.product = _store.product(i);
+        state.capacity = _store.capacity(i);
+        state.count = _store.published_count(i);
+        state.empty = _store.published_empty(i);
+        _journal.write_checkpoint(state);
+    }
+    _journal.end_checkpoint();
+}
+
+void ShelfEngine::log_change(uint64_t time, uint16_t shelf, ShelfJournalField field, uint32_t value)
+{
+    _journal.append(shelf, field, value);
+    if (_offline.is_active()) {
+        _offline.append((time > _offline_since) ? (uint32_t)(time - _offline_since) : 0, shelf, field, value);
+    }
+}
+
+void ShelfEngine::connection_changed(bool registered)
+{
+    _registered = registered;
+
+    // The status of the notifications sent before is not reported anymore.
+    _notifications.reset();
+
+    if (!registered) {
+        printf("Client offline, buffering shelf changes\n");
+        _offline_since = _published_time;
+        _offline.start();
+        return;
+    }
+
+    uint8_t *batch = (uint8_t*)malloc(OFFLINE_BUFFER_BATCH_SIZE);
+    if (batch == NULL) {
+        _offline.close();
+        return;
+    }
+    size_t length = _offline.compact(_shelf_count, batch, OFFLINE_BUFFER_BATCH_SIZE);
+    if (length > 0) {
+        _offline_changes->set_value(batch, length);
+        printf("Client online, published %lu bytes of offline changes\n", (unsigned long)length);
+    }
+    free(batch);
+}
+
+bool ShelfEngine::start_workers(SimpleM2MClient &client)
+{
+    if (drain_tasklet < 0) {
+        if (pal_osMutexCreate(&drain_mutex) != PAL_SUCCESS) {
+            return false;
+        }
+        drain_tasklet = eventOS_event_handler_create(drain_handler, SHELF_ENGINE_TASKLET_INIT_EVENT);
+        if (drain_tasklet < 0) {
+            pal_osMutexDelete(&drain_mutex);
+            return false;
+        }
+    }
+
+    pal_osMutexWait(drain_mutex, PAL_RTOS_WAIT_FOREVER);
+    drain_engine = this;
+    drain_client = &client;
+
+    arm_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.event_type = SHELF_ENGINE_TASKLET_DRAIN;
+    event.receiver = drain_tasklet;
+    event.sender = drain_tasklet;
+    event.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+    drain_event = eventOS_event_send_every(&event, eventOS_event_timer_ms_to_ticks(SHELF_ENGINE_DRAIN_INTERVAL_MS));
+    pal_osMutexRelease(drain_mutex);
+    if (drain_event == NULL) {
+        return false;
+    }
+
+    _stopping = 0;
+    for (uint16_t i = 0; i < _shard_count; i++) {
+        Shard &shard = _shards[i];
+        if (pal_osSemaphoreCreate(0, &shard.done) != PAL_SUCCESS) {
+            return false;
+        }
+        shard.threaded = true;
+        if (pal_osThreadCreateWithAlloc(worker_main, &shard, PAL_osPriorityNormal,
+                                        SHELF_ENGINE_WORKER_STACK_SIZE, NULL, &shard.thread) != PAL_SUCCESS) {
+            shard.threaded = false;
+            pal_osSemaphoreDelete(&shard.done);
+            return false;
+        }
+    }
+    return true;
+}
+
+void ShelfEngine::stop_workers()
+{
+    // Detach the tasklet first, this thread publishes from now on.
+    if (drain_tasklet >= 0) {
+        pal_osMutexWait(drain_mutex, PAL_RTOS_WAIT_FOREVER);
+        if (drain_event != NULL) {
+            eventOS_cancel(drain_event);
+            drain_event = NULL;
+        }
+        drain_engine = NULL;
+        drain_client = NULL;
+        pal_osMutexRelease(drain_mutex);
+    }
+
+    // The client is closing and acknowledges nothing more, so the window
+    // would never open again for the updates the workers still emit.
+    _notifications.reset();
+
+    SPSC_STORE_RELEASE(&_stopping, 1);
+    for (uint16_t i = 0; i < _shard_count; i++) {
+        Shard &shard = _shards[i];
+        if (!shard.threaded) {
+            continue;
+        }
+
+        // Keep draining, a worker may be waiting for room in its queue.
+        int32_t available;
+        while (pal_osSemaphoreWait(shard.done, 0, &available) != PAL_SUCCESS) {
+            drain();
+            pal_osDelay(1);
+        }
+        pal_osThreadTerminate(&shard.thread);
+        pal_osSemaphoreDelete(&shard.done);
+    }
+
+    drain();
+    for (uint16_t i = 0; i < _shard_count; i++) {
+        _shards[i].threaded = false;
+    }
+}
+
+void ShelfEngine::run_shard(Shard &shard)
+{
+    while (!SPSC_LOAD_ACQUIRE(&_stopping)) {
+        uint64_t now = shard.clock.now();
+        shard.wheel->advance(now, timer_expired, &shard);
+
+        uint64_t next = shard.wheel->next_event();
+        if (next == TimingWheel::NO_EVENT) {
+            next = now + SHELF_ENGINE_MAX_WAIT_MS;
+        }
+        shard.clock.wait_until(next, SHELF_ENGINE_MAX_WAIT_MS);
+    }
+}
+
+bool ShelfEngine::start_replay()
+{
+    uint16_t shelf_count;
+    if (!_log.open_for_replay(shelf_count)) {
+        return false;
+    }
+    if (shelf_count != _shelf_count) {
+        printf("Sale log has %d shelves, replaying the first %d\n", shelf_count, _shelf_count);
+    }
+
+    if (!_log.read(_replay_record)) {
+        printf("Sale log is empty\n");
+        _log.close();
+        return false;
+    }
+
+    _shards[0].wheel->insert(_replay_timer, _start + _replay_record.time);
+    return true;
+}
+
+void ShelfEngine::replay_step(Shard &shard)
+{
+    // Apply every record due at this time, then wait for the next one.
+    do {
+        if (_replay_record.shelf < _shelf_count) {
+            Shelf &shelf = _shelves[_replay_record.shelf];
+            switch (_replay_record.event) {
+                case SALE_LOG_EVENT_COUNT:
+                    // The log holds the net change of a tick, so a sale in
+                    // the same tick as a restock is not seen here.
+                    for (int32_t sold = 0; sold > _replay_record.value; sold--) {
+                        record_sale(shard, _replay_record.shelf);
+                    }
+                    set_count(shelf, _store.count(_replay_record.shelf) + _replay_record.value);
+                    commit(shard, shelf);
+                    break;
+                case SALE_LOG_EVENT_EMPTY:
+                    _store.set_empty(_replay_record.shelf, _replay_record.value);
+                    commit(shard, shelf);
+                    break;
+                case SALE_LOG_EVENT_PRODUCT:
+                    set_product(shelf, _replay_record.value);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (!_log.read(_replay_record)) {
+            printf("Sale log replay completed\n");
+            _log.close();
+            return;
+        }
+    } while (_start + _replay_record.time <= shard.now);
+
+    shard.wheel->insert(_replay_timer, _start + _replay_record.time);
+}
+
+void ShelfEngine::timer_expired(TimerNode &node, void *context)
+{
+    Shard *shard = (Shard*)context;
+    ShelfEngine *engine = shard->engine;
+
+    shard->now = node.expires;
+    if (&node == &engine->_replay_timer) {
+        engine->replay_step(*shard);
+    } else if (&node == &shard->rate_timer) {
+        engine->refresh_rates(*shard);
+    } else {
+        engine->process(*shard, *(Shelf*)node.data);
+    }
+}
+
+void ShelfEngine::worker_main(void const *argument)
+{
+    Shard *shard = (Shard*)argument;
+
+    shard->engine->run_shard(*shard);
+    pal_osSemaphoreRelease(shard->done);
+}
+
+void ShelfEngine::drain_handler(arm_event_s *event)
+{
+    if (event->event_type != SHELF_ENGINE_TASKLET_DRAIN) {
+        return;
+    }
+
+    pal_osMutexWait(drain_mutex, PAL_RTOS_WAIT_FOREVER);
+    if (drain_engine != NULL) {
+        drain_engine->service(*drain_client);
+    }
+    pal_osMutexRelease(drain_mutex);
+}
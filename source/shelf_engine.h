@@ -0,0 +1,412 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SHELF_ENGINE_H__
+#define __SHELF_ENGINE_H__
+
+#include "timing_wheel.h"
+#include "sim_clock.h"
+#include "sale_log.h"
+#include "shelf_store.h"
+#include "product_catalog.h"
+#include "sales_rate.h"
+#include "sim_random.h"
+#include "shelf_journal.h"
+#include "offline_buffer.h"
+#include "spsc_queue.h"
+#include "scenario.h"
+#include "shelf_history.h"
+#include "shelf_gateway.h"
+#include "notification_queue.h"
+#include "pal.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SimpleM2MClient;
+class M2MResource;
+struct arm_event_s;
+
+// Number of shelves simulated by one process. Each shelf is an instance
+// of object 10341, so the shelf with index n is found at 10341/n/x.
+#ifndef SHELF_ENGINE_SHELF_COUNT
+#define SHELF_ENGINE_SHELF_COUNT 1
+#endif
+
+// Longest real time the engine sleeps before checking the client state again.
+#ifndef SHELF_ENGINE_MAX_WAIT_MS
+#define SHELF_ENGINE_MAX_WAIT_MS 1000
+#endif
+
+// Real time between the store statistics printed by the engine, 0 disables them.
+#ifndef SHELF_ENGINE_STATS_INTERVAL_MS
+#define SHELF_ENGINE_STATS_INTERVAL_MS 60000
+#endif
+
+// Number of waits between sales drawn at once into each shelf.
+#ifndef SHELF_ENGINE_DELAY_BATCH
+#define SHELF_ENGINE_DELAY_BATCH 4
+#endif
+
+// Simulated time between two refreshes of the sales rate resources.
+#ifndef SHELF_ENGINE_RATE_INTERVAL_MS
+#define SHELF_ENGINE_RATE_INTERVAL_MS 5000
+#endif
+
+// Number of worker threads simulating the shelves, each one owning a shard
+// of them. 0 simulates all shelves on the thread calling run().
+#ifndef SHELF_ENGINE_WORKER_COUNT
+#define SHELF_ENGINE_WORKER_COUNT 0
+#endif
+
+// Updates each worker can queue for the client thread.
+#ifndef SHELF_ENGINE_QUEUE_SIZE
+#define SHELF_ENGINE_QUEUE_SIZE 4096
+#endif
+
+// Period of the client event loop tasklet draining the worker queues.
+#ifndef SHELF_ENGINE_DRAIN_INTERVAL_MS
+#define SHELF_ENGINE_DRAIN_INTERVAL_MS 10
+#endif
+
+// Stack of a worker thread.
+#ifndef SHELF_ENGINE_WORKER_STACK_SIZE
+#define SHELF_ENGINE_WORKER_STACK_SIZE (16 * 1024)
+#endif
+
+// Whether every shelf also publishes its counters as one observable CBOR
+// payload at 10341/n/26347, see ShelfEngine.
+#ifndef SHELF_ENGINE_STATE_RESOURCE
+#define SHELF_ENGINE_STATE_RESOURCE 1
+#endif
+
+// Whether the count, empty and sales resources of a shelf are observable
+// on their own. Turning it off with the state resource on makes a change of
+// a shelf cost one notification, observers of a single field then have to
+// observe the state resource instead.
+#ifndef SHELF_ENGINE_OBSERVE_FIELDS
+#define SHELF_ENGINE_OBSERVE_FIELDS 1
+#endif
+
+// What the shelves do with a count or sales value of a resource the client
+// is still notifying once the notification queue is congested, see
+// NotificationPolicy. 0 coalesces the values, 1 drops them and 2 holds the
+// simulation until the client caught up.
+#ifndef SHELF_ENGINE_NOTIFICATION_POLICY
+#define SHELF_ENGINE_NOTIFICATION_POLICY 2
+#endif
+
+#define SHELF_OBJECT_ID                 10341
+#define SHELF_RESOURCE_PRODUCT_ID       26341
+#define SHELF_RESOURCE_CURRENT_COUNT    26342
+#define SHELF_RESOURCE_EMPTY            26343
+#define SHELF_RESOURCE_SALES_1_MIN      26344
+#define SHELF_RESOURCE_SALES_15_MIN     26345
+#define SHELF_RESOURCE_SALES_1_HOUR     26346
+#define SHELF_RESOURCE_STATE            26347
+
+// Compacted batch of the shelf changes made while the client was offline.
+#define SHELF_OFFLINE_OBJECT_ID         5000
+#define SHELF_OFFLINE_RESOURCE_CHANGES  3
+
+/**
+ * \brief Simulates the sales of a number of shelves.
+ *
+ *        Every shelf runs the same timeline as the original single shelf
+ *        example: a random wait between sales, a sale which may be cancelled
+ *        after a second and a restock ten seconds after the shelf ran empty.
+ *        Each step posts the deadline of the next one to a timing wheel and
+ *        the engine only sleeps until the earliest deadline, so adding
+ *        shelves does not add threads.
+ *
+ *        The state of the shelves lives in a ShelfStore. The changes made
+ *        during a tick are committed at its end and only if the value
+ *        differs from the one committed before, so a cancelled sale does not
+ *        cost any notifications.
+ *
+ *        The number of sales over the last minute, 15 minutes and hour are
+ *        published as observable resources too, refreshed every
+ *        SHELF_ENGINE_RATE_INTERVAL_MS, so the cloud can follow the sales
+ *        velocity without observing every count change.
+ *
+ *        With SHELF_ENGINE_STATE_RESOURCE the count, empty flag and sales
+ *        of a shelf are also published together at 10341/n/26347 as a CBOR
+ *        array [count, empty, sales_1_min, sales_15_min, sales_1_hour] of
+ *        unsigned integers. The shelves changed by a batch of updates set
+ *        it once at the end of the batch, so a sale that empties a shelf
+ *        costs a single notification when SHELF_ENGINE_OBSERVE_FIELDS is
+ *        disabled.
+ *
+ *        Every shelf draws from its own SimRandom stream, split from the
+ *        seed given to start(), so a shelf behaves the same whatever else
+ *        runs in the process.
+ *
+ *        Capacities, sale probabilities, the waits between sales and the
+ *        restocks follow the Scenario loaded by create_shelves(), whose
+ *        demand curves stretch or shorten the drawn waits.
+ *
+ *        Committed changes are persisted by a ShelfJournal, so restore()
+ *        picks the shelves up where they were before a restart instead of
+ *        refilling them.
+ *
+ *        While the client is not registered the committed changes are also
+ *        kept in an OfflineBuffer, published as one compacted batch at
+ *        5000/0/3 once the client is registered again.
+ *
+ *        A ShelfGateway can name the legacy device each shelf bridges, so
+ *        one process serves a store of them through a single endpoint.
+ *
+ *        Every published count is also appended to a ShelfHistory, a
+ *        compact time series of the shelves for offline analysis.
+ *
+ *        The resources of the shelves are set through a NotificationQueue,
+ *        which coalesces the values of a resource and only hands them to
+ *        the client as fast as it acknowledges them. Empty flags, and the
+ *        state of a shelf whose empty flag changed, go ahead of the counts
+ *        and sales, so a burst of sales cannot delay a shelf running empty
+ *        or being restocked.
+ *
+ *        Once the queue is congested the counts and sales follow
+ *        SHELF_ENGINE_NOTIFICATION_POLICY. Holding the simulation leaves the
+ *        updates in the shard queues, so the workers stall in emit() until
+ *        the client acknowledged enough notifications. Either way a shard is
+ *        held back for at most SHELF_ENGINE_MAX_WAIT_MS, after which its
+ *        updates are coalesced instead.
+ *
+ *        The shelves are split into shards of contiguous shelves, each with
+ *        its own wheel and clock. Without workers a single shard runs on the
+ *        thread calling run() and publishes its updates directly. With
+ *        SHELF_ENGINE_WORKER_COUNT workers every shard runs on its own
+ *        thread and hands its updates to a single producer single consumer
+ *        queue, drained by a tasklet on the client event loop thread. Only
+ *        that thread touches the resources, the sale log, the journal and
+ *        the offline buffer. Recording or replaying the sale log needs the
+ *        updates in time order, so it always runs without workers.
+ */
+class ShelfEngine
+{
+    typedef enum {
+        SHELF_STATE_IDLE,
+        SHELF_STATE_WAIT_SALE,
+        SHELF_STATE_WAIT_UNSALE,
+        SHELF_STATE_WAIT_RESTOCK
+    } ShelfState;
+
+    typedef enum {
+        SHELF_UPDATE_COUNT,
+        SHELF_UPDATE_EMPTY,
+        SHELF_UPDATE_SALES      // followed by one per SalesRateWindow
+    } ShelfUpdateField;
+
+    // Notification queue entries of a shelf, one per ShelfUpdateField and
+    // the state resource last.
+    enum {
+        SHELF_NOTICE_STATE  = SHELF_UPDATE_SALES + SALES_RATE_WINDOW_COUNT,
+        SHELF_NOTICE_COUNT  = SHELF_NOTICE_STATE + (SHELF_ENGINE_STATE_RESOURCE ? 1 : 0)
+    };
+
+    struct Shelf {
+        TimerNode   timer;
+        M2MResource *product_id;
+        M2MResource *current_count;
+        M2MResource *empty;
+        M2MResource *sales[SALES_RATE_WINDOW_COUNT];
+        M2MResource *state_resource;
+        uint16_t    published_sales[SALES_RATE_WINDOW_COUNT];   // by the shard
+        uint16_t    reported_sales[SALES_RATE_WINDOW_COUNT];    // by publish()
+        SimRandom   random;
+        const uint16_t *demand;
+        uint32_t    sale_prob;
+        uint16_t    delays[SHELF_ENGINE_DELAY_BATCH];
+        uint8_t     next_delay;
+        uint8_t     state;
+        bool        state_dirty;
+        bool        state_edge;     // the empty flag changed since the last state
+    };
+
+    // A resource change handed from a shard to the publishing thread.
+    struct ShelfUpdate {
+        uint64_t    time;   // ms since the start of the simulation
+        int32_t     delta;  // change of the count, for the sale log
+        uint32_t    value;
+        uint32_t    made_us; // real time, when measuring the latency
+        uint16_t    shelf;
+        uint8_t     field;
+    };
+
+    struct Shard {
+        ShelfEngine *engine;
+        TimingWheel *wheel;
+        SimClock    clock;
+        uint64_t    now;
+        TimerNode   rate_timer;
+        SpscQueue<ShelfUpdate> queue;
+        ShelfUpdate held;       // popped while the notifications were congested
+        uint64_t    hold_since; // real time the update was first held
+        bool        holding;
+        bool        blocked;    // emit() is held back since hold_since
+        palThreadID_t thread;
+        palSemaphoreID_t done;
+        uint16_t    begin;
+        uint16_t    end;
+        bool        threaded;
+    };
+
+public:
+    typedef void (*publish_cb)(uint32_t latency_us, void *context);
+
+    ShelfEngine();
+
+    ~ShelfEngine();
+
+    /**
+     * \brief Creates the resources of shelf_count shelves into the client.
+     *        Must be called before SimpleM2MClient::register_and_connect().
+     *        worker_count is ignored while recording or replaying the sale log.
+     *
+     * \return false if the shelf table could not be allocated.
+     */
+    bool create_shelves(SimpleM2MClient &client, uint16_t shelf_count,
+                        uint16_t worker_count = SHELF_ENGINE_WORKER_COUNT);
+
+    /**
+     * \brief Restores the shelves from the journal. Must be called after
+     *        create_shelves() and before SimpleM2MClient::register_and_connect()
+     *        so that no notification is sent for the restored values.
+     *
+     * \return false if there was no state to restore, start() then
+     *         initializes the shelves.
+     */
+    bool restore();
+
+    /**
+     * \brief Gives every shelf a product and fills it up, seeding the
+     *        simulation with the given value. The clock runs at time_scale,
+     *        see SIM_CLOCK_TIME_SCALE.
+     *
+     *        With SALE_LOG_MODE_REPLAY the shelves are instead driven by the
+     *        recorded sale log, at the recorded speed times time_scale.
+     *        Restored shelves keep their state and only resume selling.
+     */
+    void start(uint64_t seed, uint32_t time_scale = SIM_CLOCK_TIME_SCALE);
+
+    /**
+     * \brief Drives all shelves until the client is closed.
+     */
+    void run(SimpleM2MClient &client);
+
+    uint16_t shelf_count() const;
+
+    /**
+     * \brief Calls cb on the publishing thread for every published update,
+     *        with the real time from the change to its publication. Must be
+     *        called before run(), e.g. by a benchmark.
+     */
+    void set_publish_callback(publish_cb cb, void *context);
+
+    /**
+     * \brief Prints the heap and static memory spent per shelf, which is
+     *        also the marginal cost of every bridged device.
+     */
+    void print_memory_stats() const;
+
+    /**
+     * \brief Prints the store-wide stock statistics. The figures are only
+     *        approximate while workers are running.
+     */
+    void print_statistics() const;
+
+private:
+    void schedule(Shard &shard, Shelf &shelf, ShelfState state, uint32_t delay_ms);
+    void process(Shard &shard, Shelf &shelf);
+    void sell(Shard &shard, Shelf &shelf);
+    void finish_tick(Shard &shard, Shelf &shelf);
+    uint32_t sale_delay(Shard &shard, Shelf &shelf);
+
+    uint16_t index(const Shelf &shelf) const;
+    void set_product(Shelf &shelf, uint32_t product);
+    void set_count(Shelf &shelf, int32_t count);
+    void commit(Shard &shard, Shelf &shelf);
+    void record_sale(Shard &shard, uint16_t shelf);
+    void refresh_rates(Shard &shard);
+    void emit(Shard &shard, uint16_t shelf, uint8_t field, uint32_t value, int32_t delta);
+
+    // Publishing side, see the class description for its thread.
+    bool publish(const ShelfUpdate &update, NotificationPolicy policy);
+    void publish_state(uint16_t shelf);
+    void publish_states();
+    uint32_t notice(uint16_t shelf, uint8_t field) const;
+    void service(SimpleM2MClient &client);
+    void drain();
+    void checkpoint();
+    bool match_devices(ShelfJournalState *states);
+    void log_change(uint64_t time, uint16_t shelf, ShelfJournalField field, uint32_t value);
+    void connection_changed(bool registered);
+
+    bool start_workers(SimpleM2MClient &client);
+    void stop_workers();
+    void run_shard(Shard &shard);
+
+    bool start_replay();
+    void replay_step(Shard &shard);
+
+    static void timer_expired(TimerNode &node, void *context);
+    static void worker_main(void const *argument);
+    static void drain_handler(arm_event_s *event);
+
+private:
+    ProductCatalog _catalog;
+    ShelfGateway _gateway;
+    Scenario    _scenario;
+    uint64_t    _start;
+    SaleLog     _log;
+    int         _log_mode;
+    TimerNode   _replay_timer;
+    SaleLogRecord _replay_record;
+    SalesRateTracker _rates;
+    ShelfJournal _journal;
+    bool        _journal_enabled;
+    bool        _restored;
+    OfflineBuffer _offline;
+    ShelfHistory _history;
+    NotificationQueue _notifications;
+    uint64_t    _offline_since;
+    uint64_t    _published_time;
+    M2MResource *_offline_changes;
+    bool        _registered;
+    uint64_t    _last_stats;
+    uint64_t    _last_flush;
+    uint64_t    _last_checkpoint;
+    uint64_t    _last_history;
+    uint64_t    _update_count;
+    uint64_t    _traffic_count;
+    publish_cb  _publish_cb;
+    void        *_publish_context;
+    Shard       *_shards;
+    uint16_t    _shard_count;
+    uint16_t    _worker_count;
+    int32_t     _stopping;
+    Shelf       *_shelves;
+    uint16_t    *_dirty;
+    uint16_t    _dirty_count;
+    ShelfStore  _store;
+    uint16_t    _shelf_count;
+    size_t      _heap_used;
+};
+
+#endif /* __SHELF_ENGINE_H__ */
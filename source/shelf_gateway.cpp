@@ -0,0 +1,161 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "shelf_gateway.h"
+#include "endpoint_hash.h"
+#include "shelf_engine.h"
+#include "simplem2mclient.h"
+#include "common_setup.h"
+#include "pal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ShelfGateway::ShelfGateway() : _names(NULL), _shelf_count(0), _bridged(0)
+{
+}
+
+ShelfGateway::~ShelfGateway()
+{
+    free(_names);
+}
+
+uint16_t ShelfGateway::load(SimpleM2MClient &client, uint16_t shelf_count)
+{
+    _bridged = 0;
+    free(_names);
+    _names = (uint32_t*)calloc(shelf_count, sizeof(uint32_t));
+    _shelf_count = (_names != NULL) ? shelf_count : 0;
+    if (_names == NULL) {
+        printf("Shelf gateway: failed to allocate %d names\n", shelf_count);
+        return 0;
+    }
+
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    palFileDescriptor_t fd;
+    if (mcc_platform_get_storage_file_path(SHELF_GATEWAY_FILE_NAME, path, sizeof(path)) != 0 ||
+        pal_fsFopen(path, PAL_FS_FLAG_READONLY, &fd) != PAL_SUCCESS) {
+        return 0;
+    }
+
+    // The names are copied into the resources, the text is only needed here.
+    // One byte more than the limit is read to tell a full file from a
+    // truncated one.
+    char *text = (char*)malloc(SHELF_GATEWAY_MAX_FILE_SIZE + 2);
+    size_t read = 0;
+    if (text == NULL || pal_fsFread(&fd, text, SHELF_GATEWAY_MAX_FILE_SIZE + 1, &read) != PAL_SUCCESS) {
+        printf("Shelf gateway: failed to read %s\n", path);
+        free(text);
+        pal_fsFclose(&fd);
+        return 0;
+    }
+    pal_fsFclose(&fd);
+    text[read] = '\0';
+
+    // Only whole lines are used, a name cut off by the limit would bridge
+    // a device that does not exist.
+    if (read > SHELF_GATEWAY_MAX_FILE_SIZE) {
+        text[SHELF_GATEWAY_MAX_FILE_SIZE] = '\0';
+        char *last = strrchr(text, '\n');
+        if (last != NULL) {
+            *last = '\0';
+        } else {
+            text[0] = '\0';
+        }
+        printf("Shelf gateway: %s is larger than %d bytes, the devices after line %lu are not bridged\n",
+               path, SHELF_GATEWAY_MAX_FILE_SIZE, (unsigned long)count_lines(text));
+    }
+
+    uint32_t skipped = 0;
+    uint32_t too_long = 0;
+    uint32_t elsewhere = 0;
+    char *line = text;
+    while (line != NULL) {
+        char *end = strchr(line, '\n');
+        if (end != NULL) {
+            *end = '\0';
+        }
+        size_t length = strlen(line);
+        while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t')) {
+            line[--length] = '\0';
+        }
+
+        if (length > 0 && line[0] != '#') {
+            if (SHELF_GATEWAY_COUNT > 1 && endpoint_bucket(line, SHELF_GATEWAY_COUNT) != SHELF_GATEWAY_INDEX) {
+                elsewhere++;
+            } else if (_bridged == shelf_count) {
+                skipped++;
+            } else if (length > SHELF_GATEWAY_MAX_NAME_LENGTH) {
+                too_long++;
+            } else {
+                client.add_cloud_resource(SHELF_OBJECT_ID, _bridged, SHELF_RESOURCE_ENDPOINT_NAME,
+                                          "endpoint_name", M2MResourceInstance::STRING,
+                                          M2MBase::GET_ALLOWED, line, false, NULL, NULL);
+                _names[_bridged] = name_hash(line);
+                _bridged++;
+            }
+        }
+        line = (end != NULL) ? end + 1 : NULL;
+    }
+    free(text);
+
+    printf("Shelf gateway: bridging %d devices from %s\n", _bridged, path);
+    if (elsewhere > 0) {
+        printf("Shelf gateway: %lu devices belong to the other %d gateways\n",
+               (unsigned long)elsewhere, SHELF_GATEWAY_COUNT - 1);
+    }
+    if (too_long > 0) {
+        printf("Shelf gateway: %lu devices with names longer than %d characters are not bridged\n",
+               (unsigned long)too_long, SHELF_GATEWAY_MAX_NAME_LENGTH);
+    }
+    if (skipped > 0) {
+        printf("Shelf gateway: %lu devices beyond the %d shelves are not bridged\n",
+               (unsigned long)skipped, shelf_count);
+    }
+    return _bridged;
+}
+
+uint16_t ShelfGateway::bridged_count() const
+{
+    return _bridged;
+}
+
+uint32_t ShelfGateway::device(uint16_t shelf) const
+{
+    return (shelf < _shelf_count) ? _names[shelf] : 0;
+}
+
+uint32_t ShelfGateway::name_hash(const char *name)
+{
+    // 0 stands for a shelf that bridges no device.
+    uint32_t hash = (uint32_t)endpoint_hash(name);
+    return (hash != 0) ? hash : 1;
+}
+
+size_t ShelfGateway::count_lines(const char *text)
+{
+    size_t lines = (text[0] != '\0') ? 1 : 0;
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            lines++;
+        }
+    }
+    return lines;
+}
@@ -0,0 +1,107 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#ifndef __SHELF_GATEWAY_H__
+#define __SHELF_GATEWAY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SimpleM2MClient;
+
+// Name of the file listing the bridged devices in the primary partition.
+#ifndef SHELF_GATEWAY_FILE_NAME
+#define SHELF_GATEWAY_FILE_NAME "shelf_endpoints.txt"
+#endif
+
+// Largest endpoint file read, the lines after it are not bridged.
+#ifndef SHELF_GATEWAY_MAX_FILE_SIZE
+#define SHELF_GATEWAY_MAX_FILE_SIZE (32 * 1024)
+#endif
+
+// Number of gateway processes sharing the file and the index of this one.
+// Every device is bridged by the gateway its name hashes to, see
+// endpoint_bucket(), so adding a gateway only moves the devices it takes.
+#ifndef SHELF_GATEWAY_COUNT
+#define SHELF_GATEWAY_COUNT 1
+#endif
+
+#ifndef SHELF_GATEWAY_INDEX
+#define SHELF_GATEWAY_INDEX 0
+#endif
+
+// Longest endpoint name of a bridged device.
+#define SHELF_GATEWAY_MAX_NAME_LENGTH   64
+
+#define SHELF_RESOURCE_ENDPOINT_NAME    26348
+
+/**
+ * \brief Bridges legacy shelf devices through the endpoint of this process.
+ *
+ *        The cloud client serves one endpoint per process, so instead of
+ *        one process per legacy shelf, every bridged shelf is an instance
+ *        of object 10341 of this endpoint. They all share the event loop,
+ *        timers, the TLS connection and one registration.
+ *
+ *        The file lists the endpoint name of one legacy device per line.
+ *        Of the devices hashed to this gateway, the n-th is bridged by
+ *        shelf n, which publishes its name at 10341/n/26348 so the cloud
+ *        side can map the instances back to the devices. Empty lines and
+ *        lines starting with '#' are skipped, as are names longer than
+ *        SHELF_GATEWAY_MAX_NAME_LENGTH. Without the file no shelf is
+ *        bridged and the resource is not created.
+ *
+ *        Adding or removing a device renumbers the shelves after it, so
+ *        the journal keys the saved state on device() rather than on the
+ *        shelf index.
+ */
+class ShelfGateway
+{
+public:
+    ShelfGateway();
+
+    ~ShelfGateway();
+
+    /**
+     * \brief Creates the endpoint name resources of the first shelf_count
+     *        shelves from the file, if there is one.
+     *
+     * \return number of bridged shelves.
+     */
+    uint16_t load(SimpleM2MClient &client, uint16_t shelf_count);
+
+    uint16_t bridged_count() const;
+
+    /**
+     * \brief 32 bits of the endpoint hash of the device bridged by shelf,
+     *        0 if it bridges none.
+     */
+    uint32_t device(uint16_t shelf) const;
+
+private:
+    static uint32_t name_hash(const char *name);
+    static size_t count_lines(const char *text);
+
+private:
+    uint32_t    *_names;
+    uint16_t    _shelf_count;
+    uint16_t    _bridged;
+};
+
+#endif /* __SHELF_GATEWAY_H__ */
@@ -0,0 +1,371 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "shelf_history.h"
+#include "spsc_queue.h"
+#include "common_setup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHELF_HISTORY_MAGIC             "SHTS"
+#define SHELF_HISTORY_VERSION           1
+#define SHELF_HISTORY_HEADER_SIZE       12
+
+// Record count and payload length of a block.
+#define SHELF_HISTORY_BLOCK_HEADER_SIZE 6
+
+// Time, shelf and count of a record as varints, at worst.
+#define SHELF_HISTORY_MAX_RECORD        16
+
+// Longest wait for the writer before the ring is checked again, in case a
+// release of the semaphore was lost to its maximum count.
+#define SHELF_HISTORY_STALL_WAIT_MS     10
+
+static uint64_t now_ms()
+{
+    return pal_osKernelSysMilliSecTick(pal_osKernelSysTick());
+}
+
+static void put_le16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void put_le32(uint8_t *buffer, uint32_t value)
+{
+    put_le16(buffer, (uint16_t)value);
+    put_le16(buffer + 2, (uint16_t)(value >> 16));
+}
+
+static uint32_t get_le32(const uint8_t *buffer)
+{
+    return buffer[0] | (buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static size_t write_varint(uint8_t *buffer, uint64_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+// Maps small negative values to small varints too: 0, -1, 1, -2, ...
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static bool file_path(uint32_t index, char *path, size_t size)
+{
+    char name[32];
+    snprintf(name, sizeof(name), SHELF_HISTORY_FILE_NAME, (unsigned)index);
+    return mcc_platform_get_storage_file_path(name, path, size) == 0;
+}
+
+ShelfHistory::ShelfHistory() : _blocks(NULL), _shelf_count(0), _stalls(0), _dropped(0), _head(0), _tail(0),
+    _stopping(0), _last_counts(NULL), _encoded(NULL), _fd(0), _file_open(false), _file_size(0),
+    _sequence(0), _thread(0), _wake(0), _space(0), _done(0)
+{
+}
+
+ShelfHistory::~ShelfHistory()
+{
+    close();
+}
+
+bool ShelfHistory::open(uint16_t shelf_count)
+{
+    if (is_open()) {
+        return true;
+    }
+
+    _shelf_count = shelf_count;
+    _blocks = (Block*)malloc(SHELF_HISTORY_BLOCK_COUNT * sizeof(Block));
+    _last_counts = (uint16_t*)malloc(shelf_count * sizeof(uint16_t));
+    _encoded = (uint8_t*)malloc(SHELF_HISTORY_BLOCK_HEADER_SIZE +
+                                SHELF_HISTORY_BLOCK_RECORDS * SHELF_HISTORY_MAX_RECORD);
+    if (_blocks == NULL || _last_counts == NULL || _encoded == NULL) {
+        printf("Shelf history: failed to allocate the buffers\n");
+        close();
+        return false;
+    }
+    for (uint32_t i = 0; i < SHELF_HISTORY_BLOCK_COUNT; i++) {
+        _blocks[i].count = 0;
+    }
+
+    if (pal_osSemaphoreCreate(0, &_wake) != PAL_SUCCESS) {
+        close();
+        return false;
+    }
+    if (pal_osSemaphoreCreate(0, &_space) != PAL_SUCCESS) {
+        pal_osSemaphoreDelete(&_wake);
+        close();
+        return false;
+    }
+    if (pal_osSemaphoreCreate(0, &_done) != PAL_SUCCESS) {
+        pal_osSemaphoreDelete(&_wake);
+        pal_osSemaphoreDelete(&_space);
+        close();
+        return false;
+    }
+
+    find_sequence();
+
+    _stalls = 0;
+    _dropped = 0;
+    _head = 0;
+    _tail = 0;
+    _stopping = 0;
+    if (pal_osThreadCreateWithAlloc(writer_main, this, PAL_osPriorityBelowNormal,
+                                    SHELF_HISTORY_WRITER_STACK_SIZE, NULL, &_thread) != PAL_SUCCESS) {
+        printf("Shelf history: failed to start the writer\n");
+        pal_osSemaphoreDelete(&_wake);
+        pal_osSemaphoreDelete(&_space);
+        pal_osSemaphoreDelete(&_done);
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ShelfHistory::is_open() const
+{
+    return _blocks != NULL;
+}
+
+void ShelfHistory::flush()
+{
+    if (is_open() && _blocks[_head % SHELF_HISTORY_BLOCK_COUNT].count > 0) {
+        hand_off();
+    }
+}
+
+void ShelfHistory::close()
+{
+    if (_thread != 0) {
+        // Queue the last block and have the writer exit once everything
+        // is written.
+        if (_blocks[_head % SHELF_HISTORY_BLOCK_COUNT].count > 0) {
+            hand_off();
+        }
+        SPSC_STORE_RELEASE(&_stopping, 1);
+        pal_osSemaphoreRelease(_wake);
+        int32_t available;
+        pal_osSemaphoreWait(_done, PAL_RTOS_WAIT_FOREVER, &available);
+        pal_osThreadTerminate(&_thread);
+        pal_osSemaphoreDelete(&_wake);
+        pal_osSemaphoreDelete(&_space);
+        pal_osSemaphoreDelete(&_done);
+        _thread = 0;
+
+        if (_stalls > 0) {
+            printf("Shelf history: waited %lu times for the writer, dropped %lu changes\n",
+                   (unsigned long)_stalls, (unsigned long)_dropped);
+        }
+    }
+
+    if (_file_open) {
+        pal_fsFclose(&_fd);
+        _file_open = false;
+    }
+    free(_blocks);
+    free(_last_counts);
+    free(_encoded);
+    _blocks = NULL;
+    _last_counts = NULL;
+    _encoded = NULL;
+}
+
+uint32_t ShelfHistory::stalls() const
+{
+    return _stalls;
+}
+
+uint32_t ShelfHistory::dropped() const
+{
+    return _dropped;
+}
+
+void ShelfHistory::hand_off()
+{
+    // The next block to fill must not be one the writer still has to write.
+    // If it is, wait a little for the writer, then drop the current block
+    // rather than hold up the caller. The semaphore may hold releases of
+    // earlier blocks, so check again after every wake up.
+    if (_head + 1 - SPSC_LOAD_ACQUIRE(&_tail) >= SHELF_HISTORY_BLOCK_COUNT) {
+        _stalls++;
+        uint64_t started = now_ms();
+        do {
+            if (now_ms() - started >= SHELF_HISTORY_MAX_STALL_MS) {
+                Block &block = _blocks[_head % SHELF_HISTORY_BLOCK_COUNT];
+                _dropped += block.count;
+                block.count = 0;
+                return;
+            }
+            pal_osSemaphoreRelease(_wake);
+            int32_t available;
+            pal_osSemaphoreWait(_space, SHELF_HISTORY_STALL_WAIT_MS, &available);
+        } while (_head + 1 - SPSC_LOAD_ACQUIRE(&_tail) >= SHELF_HISTORY_BLOCK_COUNT);
+    }
+
+    SPSC_STORE_RELEASE(&_head, _head + 1);
+    _blocks[_head % SHELF_HISTORY_BLOCK_COUNT].count = 0;
+    pal_osSemaphoreRelease(_wake);
+}
+
+void ShelfHistory::write_block(const Block &block)
+{
+    if ((!_file_open || _file_size >= SHELF_HISTORY_FILE_SIZE) && !open_next_file()) {
+        return;
+    }
+
+    size_t length = encode(block, _encoded);
+    size_t written = 0;
+    if (pal_fsFwrite(&_fd, _encoded, length, &written) != PAL_SUCCESS || written != length) {
+        printf("Shelf history: write failed\n");
+        pal_fsFclose(&_fd);
+        _file_open = false;
+        return;
+    }
+    _file_size += length;
+}
+
+size_t ShelfHistory::encode(const Block &block, uint8_t *out)
+{
+    const Record *records = block.records;
+    uint16_t count = block.count;
+    size_t length = SHELF_HISTORY_BLOCK_HEADER_SIZE;
+
+    // Changes come at a steady pace, so the delta of delta of their times
+    // is mostly 0 or close to it.
+    length += write_varint(out + length, block.base + records[0].time);
+    int64_t previous_delta = 0;
+    for (uint16_t i = 1; i < count; i++) {
+        int64_t delta = (int64_t)records[i].time - records[i - 1].time;
+        length += write_varint(out + length, zigzag(delta - previous_delta));
+        previous_delta = delta;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        length += write_varint(out + length, records[i].shelf);
+    }
+
+    // A count moves by one most of the time, so store the change from the
+    // previous count of the same shelf. Blocks decode on their own, each
+    // shelf starts at 0.
+    memset(_last_counts, 0, _shelf_count * sizeof(uint16_t));
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t shelf = records[i].shelf;
+        length += write_varint(out + length, zigzag((int32_t)records[i].count - _last_counts[shelf]));
+        _last_counts[shelf] = records[i].count;
+    }
+
+    put_le16(out, count);
+    put_le32(out + 2, (uint32_t)(length - SHELF_HISTORY_BLOCK_HEADER_SIZE));
+    return length;
+}
+
+bool ShelfHistory::open_next_file()
+{
+    if (_file_open) {
+        pal_fsFclose(&_fd);
+        _file_open = false;
+    }
+
+    // Overwrite the oldest file of the rotation.
+    _sequence++;
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    if (!file_path(_sequence % SHELF_HISTORY_FILE_COUNT, path, sizeof(path))) {
+        return false;
+    }
+    palStatus_t status = pal_fsFopen(path, PAL_FS_FLAG_READWRITETRUNC, &_fd);
+    if (status != PAL_SUCCESS) {
+        printf("Shelf history: failed to open %s - %d\n", path, (int)status);
+        return false;
+    }
+
+    uint8_t header[SHELF_HISTORY_HEADER_SIZE];
+    memcpy(header, SHELF_HISTORY_MAGIC, 4);
+    header[4] = SHELF_HISTORY_VERSION;
+    header[5] = 0;
+    put_le16(header + 6, _shelf_count);
+    put_le32(header + 8, _sequence);
+
+    size_t written = 0;
+    if (pal_fsFwrite(&_fd, header, sizeof(header), &written) != PAL_SUCCESS || written != sizeof(header)) {
+        printf("Shelf history: failed to write %s\n", path);
+        pal_fsFclose(&_fd);
+        return false;
+    }
+    _file_open = true;
+    _file_size = SHELF_HISTORY_HEADER_SIZE;
+    return true;
+}
+
+void ShelfHistory::find_sequence()
+{
+    // Continue after the newest file left by a previous run.
+    _sequence = 0;
+    for (uint32_t i = 0; i < SHELF_HISTORY_FILE_COUNT; i++) {
+        char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+        palFileDescriptor_t fd;
+        if (!file_path(i, path, sizeof(path)) || pal_fsFopen(path, PAL_FS_FLAG_READONLY, &fd) != PAL_SUCCESS) {
+            continue;
+        }
+
+        uint8_t header[SHELF_HISTORY_HEADER_SIZE];
+        size_t read = 0;
+        if (pal_fsFread(&fd, header, sizeof(header), &read) == PAL_SUCCESS && read == sizeof(header) &&
+            memcmp(header, SHELF_HISTORY_MAGIC, 4) == 0 && get_le32(header + 8) > _sequence) {
+            _sequence = get_le32(header + 8);
+        }
+        pal_fsFclose(&fd);
+    }
+}
+
+void ShelfHistory::writer_main(void const *argument)
+{
+    ShelfHistory *history = (ShelfHistory*)argument;
+
+    for (;;) {
+        int32_t available;
+        pal_osSemaphoreWait(history->_wake, PAL_RTOS_WAIT_FOREVER, &available);
+
+        // Read the flag first, the blocks queued before it are then seen below.
+        bool stopping = SPSC_LOAD_ACQUIRE(&history->_stopping);
+        uint32_t tail = history->_tail;
+        while (tail != SPSC_LOAD_ACQUIRE(&history->_head)) {
+            history->write_block(history->_blocks[tail % SHELF_HISTORY_BLOCK_COUNT]);
+            tail++;
+            SPSC_STORE_RELEASE(&history->_tail, tail);
+            pal_osSemaphoreRelease(history->_space);
+        }
+        if (stopping) {
+            break;
+        }
+    }
+    pal_osSemaphoreRelease(history->_done);
+}
@@ -0,0 +1,209 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SHELF_HISTORY_H__
+#define __SHELF_HISTORY_H__
+
+#include "pal.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Whether the shelf engine exports the history of the shelf counts. Off by
+// default, as it keeps writing to the flash.
+#ifndef SHELF_HISTORY_ENABLED
+#define SHELF_HISTORY_ENABLED 0
+#endif
+
+// Name of the history files in the primary partition, %u is the index of
+// the file in the rotation.
+#ifndef SHELF_HISTORY_FILE_NAME
+#define SHELF_HISTORY_FILE_NAME "shelf_history_%u.bin"
+#endif
+
+// Number of files in the rotation, the oldest one is overwritten.
+#ifndef SHELF_HISTORY_FILE_COUNT
+#define SHELF_HISTORY_FILE_COUNT 4
+#endif
+
+// Size at which a history file is closed and the next one started.
+#ifndef SHELF_HISTORY_FILE_SIZE
+#define SHELF_HISTORY_FILE_SIZE (64 * 1024)
+#endif
+
+// Changes collected in memory before they are encoded and written as one
+// block, 8 bytes each.
+#ifndef SHELF_HISTORY_BLOCK_RECORDS
+#define SHELF_HISTORY_BLOCK_RECORDS 256
+#endif
+
+// Blocks in memory, one is being filled while the others wait for the
+// writer. Must be a power of two and at least 2.
+#ifndef SHELF_HISTORY_BLOCK_COUNT
+#define SHELF_HISTORY_BLOCK_COUNT 8
+#endif
+
+// Longest real time append() waits for the writer when every block is
+// waiting to be written, after which the block being filled is dropped.
+#ifndef SHELF_HISTORY_MAX_STALL_MS
+#define SHELF_HISTORY_MAX_STALL_MS 20
+#endif
+
+// Real time after which a partial block is written anyway.
+#ifndef SHELF_HISTORY_FLUSH_INTERVAL_MS
+#define SHELF_HISTORY_FLUSH_INTERVAL_MS 60000
+#endif
+
+// Stack of the writer thread.
+#ifndef SHELF_HISTORY_WRITER_STACK_SIZE
+#define SHELF_HISTORY_WRITER_STACK_SIZE (8 * 1024)
+#endif
+
+/**
+ * \brief Time series of the shelf counts, for offline analysis.
+ *
+ *        append() only stores the change into an in-memory block. Full
+ *        blocks are queued for a writer thread which encodes and writes
+ *        them, so the caller usually does not wait for the file system.
+ *        Only if all blocks are still waiting for the writer does append()
+ *        wait until it wrote one, counted in stalls(). The caller may be
+ *        the sale loop, so the wait is bounded by SHELF_HISTORY_MAX_STALL_MS
+ *        and the changes of the block being filled are dropped after it,
+ *        counted in dropped().
+ *
+ *        Files are written in a rotation of SHELF_HISTORY_FILE_COUNT and
+ *        start with a 12-byte header: "SHTS", version, 0, shelf count LE16
+ *        and a sequence number LE32 which orders the files. Each block is
+ *        its record count LE16 and payload length LE32, followed by three
+ *        columns of varints:
+ *          time of the first record, then the zig-zag delta of delta of
+ *          the times of the others, in ms since the start of the run
+ *          shelf of each record
+ *          zig-zag difference from the previous count of the same shelf
+ *          in the block, or from 0
+ *        Use tools/read_shelf_history.py to convert the files to CSV.
+ */
+class ShelfHistory
+{
+    struct Record {
+        int32_t     time;   // from the base time of the block, workers
+                            // publish slightly out of order
+        uint16_t    shelf;
+        uint16_t    count;
+    };
+
+    struct Block {
+        uint64_t    base;
+        uint16_t    count;
+        Record      records[SHELF_HISTORY_BLOCK_RECORDS];
+    };
+
+public:
+    ShelfHistory();
+
+    ~ShelfHistory();
+
+    /**
+     * \brief Allocates the blocks and starts the writer. The next file
+     *        of the rotation is only created by the first write.
+     */
+    bool open(uint16_t shelf_count);
+
+    bool is_open() const;
+
+    void append(uint64_t time, uint16_t shelf, uint16_t count);
+
+    /**
+     * \brief Hands the current block to the writer, even if it is not full.
+     */
+    void flush();
+
+    /**
+     * \brief Writes everything appended and stops the writer.
+     */
+    void close();
+
+    /**
+     * \brief Number of times append() waited for the writer.
+     */
+    uint32_t stalls() const;
+
+    /**
+     * \brief Number of changes dropped as the writer did not keep up.
+     */
+    uint32_t dropped() const;
+
+private:
+    void hand_off();
+    void write_block(const Block &block);
+    size_t encode(const Block &block, uint8_t *out);
+    bool open_next_file();
+    void find_sequence();
+    static void writer_main(void const *argument);
+
+private:
+    Block       *_blocks;
+    uint16_t    _shelf_count;
+    uint32_t    _stalls;
+    uint32_t    _dropped;
+
+    // Blocks from _tail to _head wait for the writer, _head is being filled.
+    uint32_t    _head;
+    uint32_t    _tail;
+    int32_t     _stopping;
+
+    // Writer side.
+    uint16_t    *_last_counts;
+    uint8_t     *_encoded;
+    palFileDescriptor_t _fd;
+    bool        _file_open;
+    uint32_t    _file_size;
+    uint32_t    _sequence;
+    palThreadID_t _thread;
+    palSemaphoreID_t _wake;
+    palSemaphoreID_t _space;    // released by the writer after every block
+    palSemaphoreID_t _done;
+};
+
+inline void ShelfHistory::append(uint64_t time, uint16_t shelf, uint16_t count)
+{
+    if (_blocks == NULL) {
+        return;
+    }
+
+    Block *block = &_blocks[_head % SHELF_HISTORY_BLOCK_COUNT];
+    int64_t offset = (int64_t)(time - block->base);
+    if (block->count > 0 && (int32_t)offset != offset) {
+        hand_off();
+        block = &_blocks[_head % SHELF_HISTORY_BLOCK_COUNT];
+    }
+    if (block->count == 0) {
+        block->base = time;
+        offset = 0;
+    }
+
+    Record &record = block->records[block->count++];
+    record.time = (int32_t)offset;
+    record.shelf = shelf;
+    record.count = count;
+    if (block->count == SHELF_HISTORY_BLOCK_RECORDS) {
+        hand_off();
+    }
+}
+
+#endif /* __SHELF_HISTORY_H__ */
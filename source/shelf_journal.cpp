@@ -0,0 +1,465 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "shelf_journal.h"
+#include "common_setup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHELF_JOURNAL_CHECKPOINT_MAGIC  "SCKP"
+#define SHELF_JOURNAL_LOG_MAGIC         "SWAL"
+#define SHELF_JOURNAL_VERSION           2
+#define SHELF_JOURNAL_HEADER_SIZE       12
+
+// device, sale_prob, product, capacity, count and empty of one shelf.
+#define SHELF_JOURNAL_STATE_SIZE        15
+
+// A log frame starts with the length and the CRC of its records.
+#define SHELF_JOURNAL_FRAME_HEADER_SIZE 6
+
+// Shelf and value of a log record as varints.
+#define SHELF_JOURNAL_MAX_RECORD        8
+
+// CRC-32 (IEEE), four bits at a time.
+static const uint32_t crc_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xF] ^ (crc >> 4);
+        crc = crc_table[(crc ^ (data[i] >> 4)) & 0xF] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+static void put_le16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void put_le32(uint8_t *buffer, uint32_t value)
+{
+    put_le16(buffer, (uint16_t)value);
+    put_le16(buffer + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get_le16(const uint8_t *buffer)
+{
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *buffer)
+{
+    return get_le16(buffer) | ((uint32_t)get_le16(buffer + 2) << 16);
+}
+
+static size_t write_varint(uint8_t *buffer, uint32_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+static bool read_varint(const uint8_t *buffer, size_t length, size_t &position, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && position < length; shift += 7) {
+        uint8_t byte = buffer[position++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_exact(palFileDescriptor_t &fd, uint8_t *data, size_t length)
+{
+    size_t read = 0;
+    return pal_fsFread(&fd, data, length, &read) == PAL_SUCCESS && read == length;
+}
+
+static void put_header(uint8_t *buffer, const char *magic, uint16_t shelf_count, uint32_t sequence)
+{
+    memcpy(buffer, magic, 4);
+    buffer[4] = SHELF_JOURNAL_VERSION;
+    buffer[5] = 0;
+    put_le16(buffer + 6, shelf_count);
+    put_le32(buffer + 8, sequence);
+}
+
+// Checks the header against magic and returns its shelf count and sequence.
+static bool get_header(const uint8_t *buffer, const char *magic, uint16_t &shelf_count, uint32_t &sequence)
+{
+    if (memcmp(buffer, magic, 4) != 0 || buffer[4] != SHELF_JOURNAL_VERSION) {
+        return false;
+    }
+    shelf_count = get_le16(buffer + 6);
+    sequence = get_le32(buffer + 8);
+    return true;
+}
+
+ShelfJournal::ShelfJournal() : _log_fd(0), _checkpoint_fd(0), _buffer(NULL), _length(0), _log_size(0),
+    _sequence(0), _valid_slot(-1), _writing_slot(0), _crc(0), _shelf_count(0), _log_open(false),
+    _checkpoint_open(false)
+{
+}
+
+ShelfJournal::~ShelfJournal()
+{
+    close();
+}
+
+bool ShelfJournal::load(ShelfJournalState *states, uint16_t shelf_count)
+{
+    static const char *slots[2] = { SHELF_JOURNAL_CHECKPOINT_A, SHELF_JOURNAL_CHECKPOINT_B };
+
+    if (!allocate_buffer()) {
+        return false;
+    }
+
+    // Look at both slots first, the next checkpoint must get a sequence
+    // above any of them even if none can be used.
+    bool present[2];
+    uint32_t sequences[2];
+    for (int i = 0; i < 2; i++) {
+        palFileDescriptor_t fd;
+        uint16_t count;
+        present[i] = false;
+        if (open(slots[i], PAL_FS_FLAG_READONLY, fd, false)) {
+            present[i] = read_exact(fd, _buffer, SHELF_JOURNAL_HEADER_SIZE) &&
+                         get_header(_buffer, SHELF_JOURNAL_CHECKPOINT_MAGIC, count, sequences[i]);
+            pal_fsFclose(&fd);
+        }
+        if (present[i] && sequences[i] > _sequence) {
+            _sequence = sequences[i];
+        }
+    }
+
+    // Newest first, fall back to the other slot if it is damaged.
+    int newest = (present[1] && (!present[0] || sequences[1] > sequences[0])) ? 1 : 0;
+    for (int k = 0; k < 2; k++) {
+        int i = k ? 1 - newest : newest;
+        if (present[i] && read_checkpoint(slots[i], states, shelf_count)) {
+            // The newer slot may only have a valid header, never overwrite
+            // the one the state comes from.
+            _valid_slot = (int8_t)i;
+            read_log(states, shelf_count, sequences[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShelfJournal::begin_checkpoint(uint16_t shelf_count)
+{
+    // Keep the current log complete in case the checkpoint fails.
+    flush();
+
+    if (!allocate_buffer()) {
+        return false;
+    }
+
+    if (_valid_slot >= 0) {
+        _writing_slot = (int8_t)(1 - _valid_slot);
+    } else {
+        _writing_slot = ((_sequence + 1) & 1) ? 0 : 1;
+    }
+    const char *slot = _writing_slot ? SHELF_JOURNAL_CHECKPOINT_B : SHELF_JOURNAL_CHECKPOINT_A;
+    if (!open(slot, PAL_FS_FLAG_READWRITETRUNC, _checkpoint_fd, true)) {
+        return false;
+    }
+    _checkpoint_open = true;
+    _shelf_count = shelf_count;
+
+    put_header(_buffer, SHELF_JOURNAL_CHECKPOINT_MAGIC, shelf_count, _sequence + 1);
+    _length = SHELF_JOURNAL_HEADER_SIZE;
+    _crc = 0;
+    return true;
+}
+
+void ShelfJournal::write_checkpoint(const ShelfJournalState &state)
+{
+    if (!_checkpoint_open) {
+        return;
+    }
+
+    if (SHELF_JOURNAL_BUFFER_SIZE - _length < SHELF_JOURNAL_STATE_SIZE) {
+        _crc = crc32_update(_crc, _buffer, _length);
+        if (!write(_checkpoint_fd, _buffer, _length)) {
+            pal_fsFclose(&_checkpoint_fd);
+            _checkpoint_open = false;
+            return;
+        }
+        _length = 0;
+    }
+
+    uint8_t *record = _buffer + _length;
+    put_le32(record, state.device);
+    put_le32(record + 4, state.sale_prob);
+    put_le16(record + 8, state.product);
+    put_le16(record + 10, state.capacity);
+    put_le16(record + 12, state.count);
+    record[14] = state.empty;
+    _length += SHELF_JOURNAL_STATE_SIZE;
+}
+
+bool ShelfJournal::end_checkpoint()
+{
+    if (!_checkpoint_open) {
+        printf("Shelf journal: checkpoint failed\n");
+        _length = SHELF_JOURNAL_FRAME_HEADER_SIZE;
+        return false;
+    }
+
+    _crc = crc32_update(_crc, _buffer, _length);
+    put_le32(_buffer + _length, _crc);
+    _length += 4;
+
+    bool written = write(_checkpoint_fd, _buffer, _length);
+    written = (pal_fsFclose(&_checkpoint_fd) == PAL_SUCCESS) && written;
+    _checkpoint_open = false;
+    _length = SHELF_JOURNAL_FRAME_HEADER_SIZE;
+    if (!written) {
+        printf("Shelf journal: checkpoint failed\n");
+        return false;
+    }
+
+    // The checkpoint holds every change logged so far, start a new log.
+    _sequence++;
+    _valid_slot = _writing_slot;
+    return start_log(_shelf_count);
+}
+
+void ShelfJournal::append(uint16_t shelf, ShelfJournalField field, uint32_t value)
+{
+    if (!_log_open) {
+        return;
+    }
+
+    if (SHELF_JOURNAL_BUFFER_SIZE - _length < SHELF_JOURNAL_MAX_RECORD) {
+        if (!flush()) {
+            return;
+        }
+    }
+
+    _length += write_varint(_buffer + _length, shelf);
+    _length += write_varint(_buffer + _length, (value << 2) | field);
+}
+
+bool ShelfJournal::flush()
+{
+    if (!_log_open || _length <= SHELF_JOURNAL_FRAME_HEADER_SIZE) {
+        return _log_open;
+    }
+
+    size_t payload = _length - SHELF_JOURNAL_FRAME_HEADER_SIZE;
+    put_le16(_buffer, (uint16_t)payload);
+    put_le32(_buffer + 2, crc32_update(0, _buffer + SHELF_JOURNAL_FRAME_HEADER_SIZE, payload));
+
+    if (!write(_log_fd, _buffer, _length)) {
+        printf("Shelf journal: log write failed, closing the log\n");
+        pal_fsFclose(&_log_fd);
+        _log_open = false;
+        _length = SHELF_JOURNAL_FRAME_HEADER_SIZE;
+        return false;
+    }
+    _log_size += _length;
+    _length = SHELF_JOURNAL_FRAME_HEADER_SIZE;
+    return true;
+}
+
+size_t ShelfJournal::log_size() const
+{
+    return _log_size;
+}
+
+void ShelfJournal::close()
+{
+    if (_log_open) {
+        flush();
+        pal_fsFclose(&_log_fd);
+        _log_open = false;
+    }
+    if (_checkpoint_open) {
+        pal_fsFclose(&_checkpoint_fd);
+        _checkpoint_open = false;
+    }
+    free(_buffer);
+    _buffer = NULL;
+    _length = 0;
+}
+
+bool ShelfJournal::allocate_buffer()
+{
+    if (_buffer == NULL) {
+        _buffer = (uint8_t*)malloc(SHELF_JOURNAL_BUFFER_SIZE);
+    }
+    return _buffer != NULL;
+}
+
+bool ShelfJournal::open(const char *name, pal_fsFileMode_t mode, palFileDescriptor_t &fd, bool report)
+{
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    if (mcc_platform_get_storage_file_path(name, path, sizeof(path)) != 0) {
+        return false;
+    }
+
+    palStatus_t status = pal_fsFopen(path, mode, &fd);
+    if (status != PAL_SUCCESS) {
+        if (report) {
+            printf("Shelf journal: failed to open %s - %d\n", path, (int)status);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool ShelfJournal::write(palFileDescriptor_t &fd, const uint8_t *data, size_t length)
+{
+    size_t written = 0;
+    return pal_fsFwrite(&fd, data, length, &written) == PAL_SUCCESS && written == length;
+}
+
+bool ShelfJournal::read_checkpoint(const char *name, ShelfJournalState *states, uint16_t shelf_count)
+{
+    palFileDescriptor_t fd;
+    if (!open(name, PAL_FS_FLAG_READONLY, fd, false)) {
+        return false;
+    }
+
+    uint16_t count;
+    uint32_t sequence;
+    bool valid = read_exact(fd, _buffer, SHELF_JOURNAL_HEADER_SIZE) &&
+                 get_header(_buffer, SHELF_JOURNAL_CHECKPOINT_MAGIC, count, sequence);
+    if (valid && count != shelf_count) {
+        printf("Shelf journal: %s holds %d shelves, not %d\n", name, count, shelf_count);
+        pal_fsFclose(&fd);
+        return false;
+    }
+
+    uint32_t crc = valid ? crc32_update(0, _buffer, SHELF_JOURNAL_HEADER_SIZE) : 0;
+    for (uint16_t i = 0; valid && i < shelf_count; i++) {
+        valid = read_exact(fd, _buffer, SHELF_JOURNAL_STATE_SIZE);
+        if (valid) {
+            crc = crc32_update(crc, _buffer, SHELF_JOURNAL_STATE_SIZE);
+            states[i].device = get_le32(_buffer);
+            states[i].sale_prob = get_le32(_buffer + 4);
+            states[i].product = get_le16(_buffer + 8);
+            states[i].capacity = get_le16(_buffer + 10);
+            states[i].count = get_le16(_buffer + 12);
+            states[i].empty = _buffer[14];
+        }
+    }
+    valid = valid && read_exact(fd, _buffer, 4) && get_le32(_buffer) == crc;
+
+    pal_fsFclose(&fd);
+    if (!valid) {
+        printf("Shelf journal: %s is not a valid checkpoint\n", name);
+    }
+    return valid;
+}
+
+void ShelfJournal::read_log(ShelfJournalState *states, uint16_t shelf_count, uint32_t sequence)
+{
+    palFileDescriptor_t fd;
+    if (!open(SHELF_JOURNAL_WAL_FILE, PAL_FS_FLAG_READONLY, fd, false)) {
+        return;
+    }
+
+    uint16_t count;
+    uint32_t log_sequence;
+    if (!read_exact(fd, _buffer, SHELF_JOURNAL_HEADER_SIZE) ||
+        !get_header(_buffer, SHELF_JOURNAL_LOG_MAGIC, count, log_sequence) ||
+        count != shelf_count || log_sequence != sequence) {
+        // A crash between a checkpoint and the start of its log leaves the
+        // log of the previous checkpoint behind, which is already included.
+        pal_fsFclose(&fd);
+        return;
+    }
+
+    // Apply frames until the end of the log or the first torn frame.
+    while (read_exact(fd, _buffer, SHELF_JOURNAL_FRAME_HEADER_SIZE)) {
+        size_t length = get_le16(_buffer);
+        uint32_t crc = get_le32(_buffer + 2);
+        if (length > SHELF_JOURNAL_BUFFER_SIZE || !read_exact(fd, _buffer, length) ||
+            crc32_update(0, _buffer, length) != crc) {
+            break;
+        }
+
+        size_t position = 0;
+        uint32_t shelf;
+        uint32_t value;
+        while (read_varint(_buffer, length, position, shelf) && read_varint(_buffer, length, position, value)) {
+            if (shelf >= shelf_count) {
+                continue;
+            }
+            switch (value & 0x3) {
+                case SHELF_JOURNAL_COUNT:
+                    states[shelf].count = (uint16_t)(value >> 2);
+                    break;
+                case SHELF_JOURNAL_EMPTY:
+                    states[shelf].empty = (uint8_t)(value >> 2);
+                    break;
+                case SHELF_JOURNAL_PRODUCT:
+                    states[shelf].product = (uint16_t)(value >> 2);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    pal_fsFclose(&fd);
+}
+
+bool ShelfJournal::start_log(uint16_t shelf_count)
+{
+    if (_log_open) {
+        pal_fsFclose(&_log_fd);
+        _log_open = false;
+    }
+
+    if (!open(SHELF_JOURNAL_WAL_FILE, PAL_FS_FLAG_READWRITETRUNC, _log_fd, true)) {
+        return false;
+    }
+
+    uint8_t header[SHELF_JOURNAL_HEADER_SIZE];
+    put_header(header, SHELF_JOURNAL_LOG_MAGIC, shelf_count, _sequence);
+    if (!write(_log_fd, header, sizeof(header))) {
+        printf("Shelf journal: log write failed, closing the log\n");
+        pal_fsFclose(&_log_fd);
+        return false;
+    }
+
+    _log_open = true;
+    _log_size = 0;
+    _length = SHELF_JOURNAL_FRAME_HEADER_SIZE;
+    return true;
+}
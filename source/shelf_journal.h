@@ -0,0 +1,159 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SHELF_JOURNAL_H__
+#define __SHELF_JOURNAL_H__
+
+#include "pal.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Whether the shelf state is persisted and restored across restarts. Off by
+// default, as the log keeps writing to the flash.
+#ifndef SHELF_JOURNAL_ENABLED
+#define SHELF_JOURNAL_ENABLED 0
+#endif
+
+// Names of the two checkpoint slots and of the write-ahead log in the
+// primary partition.
+#ifndef SHELF_JOURNAL_CHECKPOINT_A
+#define SHELF_JOURNAL_CHECKPOINT_A "shelf_state_a.bin"
+#endif
+
+#ifndef SHELF_JOURNAL_CHECKPOINT_B
+#define SHELF_JOURNAL_CHECKPOINT_B "shelf_state_b.bin"
+#endif
+
+#ifndef SHELF_JOURNAL_WAL_FILE
+#define SHELF_JOURNAL_WAL_FILE "shelf_wal.bin"
+#endif
+
+// Size of the write-ahead log after which a new checkpoint is taken.
+#ifndef SHELF_JOURNAL_WAL_LIMIT
+#define SHELF_JOURNAL_WAL_LIMIT 16384
+#endif
+
+// Real time between two flushes of the write-ahead log.
+#ifndef SHELF_JOURNAL_FLUSH_INTERVAL_MS
+#define SHELF_JOURNAL_FLUSH_INTERVAL_MS 1000
+#endif
+
+// Real time between two checkpoints, 0 only checkpoints on the log size.
+#ifndef SHELF_JOURNAL_CHECKPOINT_INTERVAL_MS
+#define SHELF_JOURNAL_CHECKPOINT_INTERVAL_MS 600000
+#endif
+
+// Size of the buffer used for batching file writes and reads.
+#ifndef SHELF_JOURNAL_BUFFER_SIZE
+#define SHELF_JOURNAL_BUFFER_SIZE 256
+#endif
+
+typedef enum {
+    SHELF_JOURNAL_COUNT     = 0, // value is the new product_current_count
+    SHELF_JOURNAL_EMPTY     = 1, // value is the new product_empty
+    SHELF_JOURNAL_PRODUCT   = 2  // value is the catalog index of the product
+} ShelfJournalField;
+
+struct ShelfJournalState {
+    uint32_t    device;     // ShelfGateway::device() of the shelf
+    uint32_t    sale_prob;
+    uint16_t    product;
+    uint16_t    capacity;
+    uint16_t    count;
+    uint8_t     empty;
+};
+
+/**
+ * \brief Persists the state of the shelves as checkpoints plus a
+ *        write-ahead log, so a restart resumes where the shelves stopped.
+ *
+ *        A checkpoint holds the full state of every shelf and is written to
+ *        the slot other than the last valid one, as PAL has no atomic rename,
+ *        so a crash while writing leaves the previous one intact. Both slots
+ *        carry a sequence number and a CRC, the newest valid one wins.
+ *
+ *        Changes made after a checkpoint are appended to the log as absolute
+ *        values in CRC protected frames tagged with the sequence of the
+ *        checkpoint they apply to. A torn frame ends the log, and a log left
+ *        over from an older checkpoint is ignored.
+ */
+class ShelfJournal
+{
+public:
+    ShelfJournal();
+
+    ~ShelfJournal();
+
+    /**
+     * \brief Reads the newest checkpoint and applies the log over it.
+     *
+     * \return false if there is no valid state for shelf_count shelves,
+     *         states is then left undefined.
+     */
+    bool load(ShelfJournalState *states, uint16_t shelf_count);
+
+    /**
+     * \brief Starts a checkpoint of shelf_count shelves. Each shelf is then
+     *        passed to write_checkpoint() in order and end_checkpoint()
+     *        commits the checkpoint and starts a new log.
+     */
+    bool begin_checkpoint(uint16_t shelf_count);
+
+    void write_checkpoint(const ShelfJournalState &state);
+
+    bool end_checkpoint();
+
+    /**
+     * \brief Adds a change to the log, written on the next flush().
+     */
+    void append(uint16_t shelf, ShelfJournalField field, uint32_t value);
+
+    bool flush();
+
+    /**
+     * \brief Bytes written to the log since the last checkpoint.
+     */
+    size_t log_size() const;
+
+    void close();
+
+private:
+    bool allocate_buffer();
+    bool open(const char *name, pal_fsFileMode_t mode, palFileDescriptor_t &fd, bool report);
+    bool write(palFileDescriptor_t &fd, const uint8_t *data, size_t length);
+    bool read_checkpoint(const char *name, ShelfJournalState *states, uint16_t shelf_count);
+    void read_log(ShelfJournalState *states, uint16_t shelf_count, uint32_t sequence);
+    bool start_log(uint16_t shelf_count);
+
+private:
+    palFileDescriptor_t _log_fd;
+    palFileDescriptor_t _checkpoint_fd;
+    uint8_t     *_buffer;
+    size_t      _length;
+    size_t      _log_size;
+    uint32_t    _sequence;
+    int8_t      _valid_slot;    // slot of the last checkpoint read or written, -1 if none
+    int8_t      _writing_slot;
+    uint32_t    _crc;
+    uint16_t    _shelf_count;
+    bool        _log_open;
+    bool        _checkpoint_open;
+};
+
+#endif /* __SHELF_JOURNAL_H__ */
@@ -0,0 +1,228 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "shelf_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#define SHELF_STORE_SSE2
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#define SHELF_STORE_NEON
+#endif
+
+#define SHELF_STORE_MAX_VALUE 32767
+
+ShelfStore::ShelfStore() :
+    _counts(NULL),
+    _capacities(NULL),
+    _low_marks(NULL),
+    _empty(NULL),
+    _products(NULL),
+    _last_sale(NULL),
+    _committed_counts(NULL),
+    _committed_empty(NULL),
+    _published_counts(NULL),
+    _published_empty(NULL),
+    _size(0)
+{
+}
+
+ShelfStore::~ShelfStore()
+{
+    release();
+}
+
+bool ShelfStore::allocate(uint16_t shelf_count)
+{
+    release();
+
+    _counts = (uint16_t*)calloc(shelf_count, sizeof(uint16_t));
+    _capacities = (uint16_t*)calloc(shelf_count, sizeof(uint16_t));
+    _low_marks = (uint16_t*)calloc(shelf_count, sizeof(uint16_t));
+    _empty = (uint8_t*)calloc(shelf_count, sizeof(uint8_t));
+    _products = (uint16_t*)calloc(shelf_count, sizeof(uint16_t));
+    _last_sale = (uint32_t*)calloc(shelf_count, sizeof(uint32_t));
+    _committed_counts = (uint16_t*)calloc(shelf_count, sizeof(uint16_t));
+    _committed_empty = (uint8_t*)calloc(shelf_count, sizeof(uint8_t));
+    _published_counts = (uint16_t*)calloc(shelf_count, sizeof(uint16_t));
+    _published_empty = (uint8_t*)calloc(shelf_count, sizeof(uint8_t));
+
+    if (!_counts || !_capacities || !_low_marks || !_empty || !_products || !_last_sale ||
+        !_committed_counts || !_committed_empty || !_published_counts || !_published_empty) {
+        release();
+        return false;
+    }
+
+    _size = shelf_count;
+    return true;
+}
+
+void ShelfStore::set_capacity(uint16_t shelf, uint16_t capacity)
+{
+    if (capacity > SHELF_STORE_MAX_VALUE) {
+        capacity = SHELF_STORE_MAX_VALUE;
+    }
+    _capacities[shelf] = capacity;
+    _low_marks[shelf] = (uint16_t)((uint32_t)capacity * SHELF_STORE_LOW_STOCK_PERCENT / 100);
+}
+
+uint32_t ShelfStore::total_count() const
+{
+    uint32_t total = 0;
+    uint32_t i = 0;
+
+#if defined (SHELF_STORE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (; i + 8 <= _size; i += 8) {
+        __m128i counts = _mm_loadu_si128((const __m128i*)(_counts + i));
+        sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(counts, zero));
+        sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(counts, zero));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, sum);
+    total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined (SHELF_STORE_NEON)
+    uint32x4_t sum = vdupq_n_u32(0);
+    for (; i + 8 <= _size; i += 8) {
+        sum = vpadalq_u16(sum, vld1q_u16(_counts + i));
+    }
+    total = vgetq_lane_u32(sum, 0) + vgetq_lane_u32(sum, 1) +
+            vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+#endif
+
+    for (; i < _size; i++) {
+        total += _counts[i];
+    }
+    return total;
+}
+
+uint32_t ShelfStore::empty_count() const
+{
+    uint32_t total = 0;
+    uint32_t i = 0;
+
+#if defined (SHELF_STORE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (; i + 16 <= _size; i += 16) {
+        // The flags are 0 or 1, so the sum of absolute differences to zero
+        // adds them up into the two 64-bit halves.
+        __m128i flags = _mm_loadu_si128((const __m128i*)(_empty + i));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(flags, zero));
+    }
+    total = (uint32_t)_mm_cvtsi128_si32(sum) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#elif defined (SHELF_STORE_NEON)
+    // At most 4096 iterations adding up to 2 per lane, a 16-bit lane cannot overflow.
+    uint16x8_t sum = vdupq_n_u16(0);
+    for (; i + 16 <= _size; i += 16) {
+        sum = vpadalq_u8(sum, vld1q_u8(_empty + i));
+    }
+    uint32x4_t wide = vpaddlq_u16(sum);
+    total = vgetq_lane_u32(wide, 0) + vgetq_lane_u32(wide, 1) +
+            vgetq_lane_u32(wide, 2) + vgetq_lane_u32(wide, 3);
+#endif
+
+    for (; i < _size; i++) {
+        total += _empty[i];
+    }
+    return total;
+}
+
+uint32_t ShelfStore::find_low_stock(uint16_t *shelves, uint32_t max_shelves) const
+{
+    uint32_t found = 0;
+    uint32_t i = 0;
+
+#if defined (SHELF_STORE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= _size; i += 8) {
+        // count <= mark exactly when the saturated count - mark is zero.
+        __m128i counts = _mm_loadu_si128((const __m128i*)(_counts + i));
+        __m128i marks = _mm_loadu_si128((const __m128i*)(_low_marks + i));
+        __m128i low = _mm_cmpeq_epi16(_mm_subs_epu16(counts, marks), zero);
+        int mask = _mm_movemask_epi8(low);
+        for (uint32_t lane = 0; mask != 0; lane++, mask >>= 2) {
+            if (mask & 1) {
+                if (found < max_shelves) {
+                    shelves[found] = i + lane;
+                }
+                found++;
+            }
+        }
+    }
+#elif defined (SHELF_STORE_NEON)
+    for (; i + 8 <= _size; i += 8) {
+        uint16x8_t low = vcleq_u16(vld1q_u16(_counts + i), vld1q_u16(_low_marks + i));
+        uint8x8_t narrow = vmovn_u16(low);
+        if (vget_lane_u64(vreinterpret_u64_u8(narrow), 0) == 0) {
+            continue;
+        }
+        uint8_t lanes[8];
+        vst1_u8(lanes, narrow);
+        for (uint32_t lane = 0; lane < 8; lane++) {
+            if (lanes[lane]) {
+                if (found < max_shelves) {
+                    shelves[found] = i + lane;
+                }
+                found++;
+            }
+        }
+    }
+#endif
+
+    for (; i < _size; i++) {
+        if (_counts[i] <= _low_marks[i]) {
+            if (found < max_shelves) {
+                shelves[found] = i;
+            }
+            found++;
+        }
+    }
+    return found;
+}
+
+void ShelfStore::release()
+{
+    free(_counts);
+    free(_capacities);
+    free(_low_marks);
+    free(_empty);
+    free(_products);
+    free(_last_sale);
+    free(_committed_counts);
+    free(_committed_empty);
+    free(_published_counts);
+    free(_published_empty);
+
+    _counts = NULL;
+    _capacities = NULL;
+    _low_marks = NULL;
+    _empty = NULL;
+    _products = NULL;
+    _last_sale = NULL;
+    _committed_counts = NULL;
+    _committed_empty = NULL;
+    _published_counts = NULL;
+    _published_empty = NULL;
+    _size = 0;
+}
@@ -0,0 +1,162 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SHELF_STORE_H__
+#define __SHELF_STORE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A shelf is low on stock when its count is at or below this percentage
+// of its capacity.
+#ifndef SHELF_STORE_LOW_STOCK_PERCENT
+#define SHELF_STORE_LOW_STOCK_PERCENT 20
+#endif
+
+/**
+ * \brief Column store of the shelf state.
+ *
+ *        Each field of the shelves is kept in its own contiguous array, so
+ *        store-wide aggregates read only the columns they need and run as
+ *        SIMD loops (SSE2 on x86, NEON on ARM Linux, plain loops elsewhere).
+ *        The store is the source of truth of the simulation, the resources
+ *        only mirror the last published values.
+ *
+ *        Counts and capacities are limited to 32767.
+ */
+class ShelfStore
+{
+public:
+    ShelfStore();
+
+    ~ShelfStore();
+
+    bool allocate(uint16_t shelf_count);
+
+    uint16_t size() const {
+        return _size;
+    }
+
+    uint16_t count(uint16_t shelf) const {
+        return _counts[shelf];
+    }
+
+    void set_count(uint16_t shelf, uint16_t count) {
+        _counts[shelf] = count;
+    }
+
+    uint16_t capacity(uint16_t shelf) const {
+        return _capacities[shelf];
+    }
+
+    void set_capacity(uint16_t shelf, uint16_t capacity);
+
+    uint8_t empty(uint16_t shelf) const {
+        return _empty[shelf];
+    }
+
+    void set_empty(uint16_t shelf, uint8_t empty) {
+        _empty[shelf] = empty ? 1 : 0;
+    }
+
+    // Index of the product in the catalog.
+    uint16_t product(uint16_t shelf) const {
+        return _products[shelf];
+    }
+
+    void set_product(uint16_t shelf, uint16_t product) {
+        _products[shelf] = product;
+    }
+
+    // Time of the last sale in seconds since the start of the simulation.
+    uint32_t last_sale(uint16_t shelf) const {
+        return _last_sale[shelf];
+    }
+
+    void set_last_sale(uint16_t shelf, uint32_t time) {
+        _last_sale[shelf] = time;
+    }
+
+    // Values of the last commit, owned by the thread simulating the shelf.
+    uint16_t committed_count(uint16_t shelf) const {
+        return _committed_counts[shelf];
+    }
+
+    uint8_t committed_empty(uint16_t shelf) const {
+        return _committed_empty[shelf];
+    }
+
+    void commit(uint16_t shelf) {
+        _committed_counts[shelf] = _counts[shelf];
+        _committed_empty[shelf] = _empty[shelf];
+    }
+
+    // Values last written to the resources, owned by the thread publishing
+    // them. They trail the committed values while updates are queued.
+    uint16_t published_count(uint16_t shelf) const {
+        return _published_counts[shelf];
+    }
+
+    void set_published_count(uint16_t shelf, uint16_t count) {
+        _published_counts[shelf] = count;
+    }
+
+    uint8_t published_empty(uint16_t shelf) const {
+        return _published_empty[shelf];
+    }
+
+    void set_published_empty(uint16_t shelf, uint8_t empty) {
+        _published_empty[shelf] = empty;
+    }
+
+    /**
+     * \brief Sum of the counts of all shelves.
+     */
+    uint32_t total_count() const;
+
+    /**
+     * \brief Number of shelves flagged empty.
+     */
+    uint32_t empty_count() const;
+
+    /**
+     * \brief Finds the shelves low on stock, see SHELF_STORE_LOW_STOCK_PERCENT.
+     *
+     * \return the number of low shelves, of which at most max_shelves
+     *         indexes are written to shelves.
+     */
+    uint32_t find_low_stock(uint16_t *shelves, uint32_t max_shelves) const;
+
+private:
+    void release();
+
+private:
+    uint16_t    *_counts;
+    uint16_t    *_capacities;
+    uint16_t    *_low_marks;
+    uint8_t     *_empty;
+    uint16_t    *_products;
+    uint32_t    *_last_sale;
+    uint16_t    *_committed_counts;
+    uint8_t     *_committed_empty;
+    uint16_t    *_published_counts;
+    uint8_t     *_published_empty;
+    uint16_t    _size;
+};
+
+#endif /* __SHELF_STORE_H__ */
@@ -0,0 +1,90 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "sim_clock.h"
+#include "common_setup.h"
+#include "pal.h"
+
+SimClock::SimClock() : _real_start(0), _virtual_start(0), _virtual_now(0), _scale(1)
+{
+}
+
+void SimClock::start(uint32_t scale)
+{
+    _scale = scale;
+    _real_start = real_now();
+    _virtual_start = _real_start;
+    _virtual_now = _real_start;
+}
+
+uint64_t SimClock::now() const
+{
+    if (_scale == 0) {
+        return _virtual_now;
+    }
+    return _virtual_start + (real_now() - _real_start) * _scale;
+}
+
+void SimClock::wait_until(uint64_t deadline, uint32_t max_real_wait_ms)
+{
+    uint64_t now = this->now();
+    if (deadline <= now) {
+        return;
+    }
+
+    if (_scale == 0) {
+        // Nothing can happen in between, so just jump to the deadline.
+        _virtual_now = deadline;
+        return;
+    }
+
+    // Round up so that the deadline has passed once we wake up.
+    uint64_t wait = (deadline - now + _scale - 1) / _scale;
+    if (wait > max_real_wait_ms) {
+        wait = max_real_wait_ms;
+    }
+    mcc_platform_do_wait((int)wait);
+}
+
+uint32_t SimClock::scale() const
+{
+    return _scale;
+}
+
+uint64_t SimClock::real_elapsed() const
+{
+    return real_now() - _real_start;
+}
+
+uint64_t SimClock::virtual_elapsed() const
+{
+    return now() - _virtual_start;
+}
+
+uint64_t SimClock::real_now()
+{
+    return pal_osKernelSysMilliSecTick(pal_osKernelSysTick());
+}
+
+uint64_t SimClock::real_now_us()
+{
+    // Split the conversion so that it cannot overflow with fast ticks.
+    uint64_t ticks = pal_osKernelSysTick();
+    uint64_t frequency = pal_osKernelSysTickFrequency();
+    return (ticks / frequency) * 1000000 + (ticks % frequency) * 1000000 / frequency;
+}
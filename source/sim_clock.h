@@ -0,0 +1,84 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SIM_CLOCK_H__
+#define __SIM_CLOCK_H__
+
+#include <stdint.h>
+
+// Speed of the simulation clock: 1 runs in real time, N runs N times faster
+// than real time and 0 runs as fast as possible, jumping straight to the
+// next deadline without sleeping.
+#ifndef SIM_CLOCK_TIME_SCALE
+#define SIM_CLOCK_TIME_SCALE 1
+#endif
+
+/**
+ * \brief Virtual clock of the simulation, in milliseconds.
+ *
+ *        Virtual time starts from the platform uptime at start() and then
+ *        runs scale times faster than the wall clock, or only moves forward
+ *        in wait_until() when running as fast as possible. Event ordering
+ *        does not depend on the scale, as the engine schedules each step
+ *        relative to the virtual deadline of the previous one.
+ */
+class SimClock
+{
+public:
+    SimClock();
+
+    void start(uint32_t scale);
+
+    /**
+     * \brief Current virtual time.
+     */
+    uint64_t now() const;
+
+    /**
+     * \brief Sleeps until the virtual deadline, but never longer than
+     *        max_real_wait_ms of real time.
+     */
+    void wait_until(uint64_t deadline, uint32_t max_real_wait_ms);
+
+    uint32_t scale() const;
+
+    /**
+     * \brief Real time elapsed since start().
+     */
+    uint64_t real_elapsed() const;
+
+    /**
+     * \brief Virtual time elapsed since start().
+     */
+    uint64_t virtual_elapsed() const;
+
+    static uint64_t real_now();
+
+    /**
+     * \brief Real time in microseconds, for measuring short intervals.
+     */
+    static uint64_t real_now_us();
+
+private:
+    uint64_t    _real_start;
+    uint64_t    _virtual_start;
+    uint64_t    _virtual_now;
+    uint32_t    _scale;
+};
+
+#endif /* __SIM_CLOCK_H__ */
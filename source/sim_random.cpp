@@ -0,0 +1,78 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "sim_random.h"
+
+SimRandom::SimRandom()
+{
+    seed(0);
+}
+
+SimRandom::SimRandom(uint64_t seed)
+{
+    this->seed(seed);
+}
+
+void SimRandom::seed(uint64_t seed)
+{
+    // Expand the seed with splitmix64, which never yields the all zero
+    // state xoshiro cannot leave.
+    uint64_t x = seed;
+    for (int i = 0; i < 2; i++) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        _s[2 * i] = (uint32_t)z;
+        _s[2 * i + 1] = (uint32_t)(z >> 32);
+    }
+}
+
+void SimRandom::jump()
+{
+    static const uint32_t JUMP[] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+
+    uint32_t s0 = 0;
+    uint32_t s1 = 0;
+    uint32_t s2 = 0;
+    uint32_t s3 = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 32; b++) {
+            if (JUMP[i] & ((uint32_t)1 << b)) {
+                s0 ^= _s[0];
+                s1 ^= _s[1];
+                s2 ^= _s[2];
+                s3 ^= _s[3];
+            }
+            next();
+        }
+    }
+
+    _s[0] = s0;
+    _s[1] = s1;
+    _s[2] = s2;
+    _s[3] = s3;
+}
+
+void SimRandom::fill_range(uint16_t *out, size_t count, uint16_t min, uint16_t max)
+{
+    uint32_t span = (uint32_t)max - min + 1;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (uint16_t)(min + below(span));
+    }
+}
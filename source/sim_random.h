@@ -0,0 +1,97 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SIM_RANDOM_H__
+#define __SIM_RANDOM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * \brief Random number stream of the simulation, xoshiro128**.
+ *
+ *        Unlike rand() a stream has no shared state, so every shelf or
+ *        thread owns one and never locks. jump() moves a stream 2^64 steps
+ *        ahead, which splits one seed into non-overlapping streams: stream n
+ *        is the seeded stream jumped n times, so the same seed always gives
+ *        the same numbers to the same shelf however the shelves are spread
+ *        over threads.
+ */
+class SimRandom
+{
+public:
+    SimRandom();
+
+    explicit SimRandom(uint64_t seed);
+
+    void seed(uint64_t seed);
+
+    /**
+     * \brief Advances the stream by 2^64 numbers.
+     */
+    void jump();
+
+    uint32_t next();
+
+    /**
+     * \brief Returns a number in [0, bound), bound must not be zero.
+     */
+    uint32_t below(uint32_t bound);
+
+    /**
+     * \brief Returns a number in [min, max].
+     */
+    uint32_t range(uint32_t min, uint32_t max);
+
+    /**
+     * \brief Fills out with count numbers in [min, max], e.g. a batch of
+     *        inter-arrival times.
+     */
+    void fill_range(uint16_t *out, size_t count, uint16_t min, uint16_t max);
+
+private:
+    uint32_t _s[4];
+};
+
+inline uint32_t SimRandom::next()
+{
+    const uint32_t result = ((_s[1] * 5) << 7 | (_s[1] * 5) >> 25) * 9;
+    const uint32_t t = _s[1] << 9;
+
+    _s[2] ^= _s[0];
+    _s[3] ^= _s[1];
+    _s[1] ^= _s[2];
+    _s[0] ^= _s[3];
+    _s[2] ^= t;
+    _s[3] = (_s[3] << 11) | (_s[3] >> 21);
+
+    return result;
+}
+
+inline uint32_t SimRandom::below(uint32_t bound)
+{
+    // Multiply and shift instead of a modulo, the bias is below bound / 2^32.
+    return (uint32_t)(((uint64_t)next() * bound) >> 32);
+}
+
+inline uint32_t SimRandom::range(uint32_t min, uint32_t max)
+{
+    return min + below(max - min + 1);
+}
+
+#endif /* __SIM_RANDOM_H__ */
@@ -29,6 +29,11 @@
 #include "resource.h"
 #include "application_init.h"
 #include "factory_configurator_client.h"
+#include "endpoint_hash.h"
+#include "reconnect_controller.h"
+#include "registration_scheduler.h"
+#include "connection_metrics.h"
+#include "pal.h"
 
 #ifdef MBED_CLOUD_CLIENT_USER_CONFIG_FILE
 #include MBED_CLOUD_CLIENT_USER_CONFIG_FILE
@@ -42,17 +47,43 @@
 #include "memory_tests.h"
 #endif
 
+// Time from the start of a registration, or from losing the connection, to
+// client_registered(), in ms. Published at 5000/0/4.
+#define SIMPLE_M2M_CLIENT_REGISTER_TIME_OBJECT_ID   5000
+#define SIMPLE_M2M_CLIENT_REGISTER_TIME_RESOURCE_ID 4
+
 class SimpleM2MClient {
 
 public:
 
     SimpleM2MClient() :
         _registered(false),
-        _register_called(false){
+        _register_called(false),
+        _unique_id(0),
+        _state_changed(0),
+        _register_started(0),
+        _time_to_registered(0),
+        _register_time_res(NULL){
+    }
+
+    ~SimpleM2MClient() {
+        if (_state_changed != 0) {
+            pal_osSemaphoreDelete(&_state_changed);
+        }
     }
 
     bool call_register() {
 
+        // Created here as PAL is only initialized by application_init().
+        if (_state_changed == 0 && pal_osSemaphoreCreate(0, &_state_changed) != PAL_SUCCESS) {
+            printf("Failed to create the registration semaphore\n");
+            _state_changed = 0;
+        }
+        _register_started = now_ms();
+        _reconnect.set_attempt_callback(&SimpleM2MClient::reconnect, this);
+        _reconnect.set_give_up_callback(&SimpleM2MClient::reconnect_given_up, this);
+        _updates.set_update_callback(&SimpleM2MClient::scheduled_update, this);
+
         _cloud_client.on_registered(this, &SimpleM2MClient::client_registered);
         _cloud_client.on_unregistered(this, &SimpleM2MClient::client_unregistered);
         _cloud_client.on_error(this, &SimpleM2MClient::error);
@@ -91,9 +122,30 @@ public:
         _cloud_client.register_update();
     }
 
+    /**
+     * \brief Tells the registration scheduler that notifications were just
+     *        sent, so a registration update that is almost due goes along.
+     *        May be called from any thread.
+     */
+    void traffic_sent() {
+        _updates.traffic();
+    }
+
     void client_registered() {
         _registered = true;
-        printf("\nClient registered\n");
+        if (_register_started != 0) {
+            _time_to_registered = (uint32_t)(now_ms() - _register_started);
+            _register_started = 0;
+            if (_register_time_res) {
+                _register_time_res->set_value(_time_to_registered);
+            }
+        }
+        printf("\nClient registered in %lu ms\n", (unsigned long)_time_to_registered);
+        _reconnect.connected();
+        if (REGISTRATION_UPDATE_ENABLED) {
+            _updates.start(_unique_id);
+        }
+        signal_state_changed();
         static const ConnectorClientEndpointInfo* endpoint = NULL;
         if (endpoint == NULL) {
             endpoint = _cloud_client.endpoint_info();
@@ -105,7 +157,8 @@ public:
 #endif
                 printf("Device Id: %s\r\n", endpoint->internal_endpoint_name.c_str());
 
-                _unique_id = get_sum(endpoint->internal_endpoint_name.c_str());
+                _unique_id = endpoint_hash(endpoint->internal_endpoint_name.c_str());
+                _reconnect.seed(_unique_id);
             }
         }
 #ifdef MBED_HEAP_STATS_ENABLED
@@ -119,6 +172,8 @@ public:
     void client_unregistered() {
         _registered = false;
         _register_called = false;
+        _updates.stop();
+        signal_state_changed();
         printf("\nClient unregistered - Exiting application\n\n");
 #ifdef MBED_HEAP_STATS_ENABLED
         print_heap_stats();
@@ -214,6 +269,29 @@ public:
         printf("\nError occurred : %s\r\n", error);
         printf("Error code : %d\r\n\n", error_code);
         printf("Error details : %s\r\n\n",_cloud_client.error_description());
+
+        // Reconnect after a connection error with a jittered backoff, the
+        // client reports client_registered() again once it is back.
+        switch(error_code) {
+            case MbedCloudClient::ConnectNetworkError:
+            case MbedCloudClient::ConnectTimeout:
+            case MbedCloudClient::ConnectSecureConnectionFailed:
+            case MbedCloudClient::ConnectDnsResolvingFailed:
+            case MbedCloudClient::ConnectNotRegistered:
+                if (_registered) {
+                    _register_started = now_ms();
+                }
+                _registered = false;
+                _updates.stop();
+                if (_register_called && !_reconnect.connection_lost()) {
+                    // Out of retries, let the application exit.
+                    _register_called = false;
+                }
+                break;
+            default:
+                break;
+        }
+        signal_state_changed();
     }
 
     bool is_client_registered() {
@@ -224,6 +302,46 @@ public:
         return _register_called;
     }
 
+    /**
+     * \brief Blocks until the client is registered, the registration was
+     *        given up or timeout_ms passed, woken by the client callbacks
+     *        instead of polling.
+     *
+     * \return true if the client is registered.
+     */
+    bool wait_for_registration(uint32_t timeout_ms) {
+        uint64_t deadline = now_ms() + timeout_ms;
+        while (!_registered && _register_called) {
+            uint64_t now = now_ms();
+            if (now >= deadline) {
+                break;
+            }
+            int32_t available;
+            if (_state_changed == 0) {
+                mcc_platform_do_wait((int)((deadline - now < 1000) ? deadline - now : 1000));
+            } else {
+                pal_osSemaphoreWait(_state_changed, (uint32_t)(deadline - now), &available);
+            }
+        }
+        return _registered;
+    }
+
+    /**
+     * \brief Time taken by the last registration or reconnection in ms, 0
+     *        until the client registered once.
+     */
+    uint32_t time_to_registered() const {
+        return _time_to_registered;
+    }
+
+    const ReconnectController& get_reconnect_controller() const {
+        return _reconnect;
+    }
+
+    const RegistrationScheduler& get_registration_scheduler() const {
+        return _updates;
+    }
+
     void register_and_connect() {
 #ifdef MBED_HEAP_STATS_ENABLED
         // Add some test resources to measure memory consumption.
@@ -233,6 +351,10 @@ public:
 #ifdef MBED_STACK_STATS_ENABLED
         print_stack_statistics();
 #endif
+        _register_time_res = add_resource(&_obj_list, SIMPLE_M2M_CLIENT_REGISTER_TIME_OBJECT_ID, 0,
+                                          SIMPLE_M2M_CLIENT_REGISTER_TIME_RESOURCE_ID, "time_to_registered",
+                                          M2MResourceInstance::INTEGER, M2MBase::GET_ALLOWED, NULL,
+                                          true, NULL, NULL);
         _cloud_client.add_objects(_obj_list);
 
         // Start registering to the cloud.
@@ -257,22 +379,56 @@ public:
                               M2MResourceInstance::ResourceType data_type,
                               M2MBase::Operation allowed, const char *value,
                               bool observable, void *cb, void *notification_status_cb) {
+         // Count the delivery of every observed value unless the caller
+         // wants to follow it itself.
+         if (observable && notification_status_cb == NULL) {
+             notification_status_cb = (void*)ConnectionMetrics::notification_status;
+         }
          return add_resource(&_obj_list, object_id, instance_id, resource_id, resource_type, data_type,
                       allowed, value, observable, cb, notification_status_cb);
     }
 
-    uint32_t get_unique_id() const {
+    /**
+     * \brief 64-bit hash of the internal endpoint name, 0 until the client
+     *        registered once.
+     */
+    uint64_t get_unique_id() const {
         return _unique_id;
     }
 
 private:
-    uint32_t get_sum(const char* cstr){
-        uint32_t cnt = 0;
-        int i = 0;
-        while(cstr[i] != '\0'){
-            cnt += cstr[i++];
+    static uint64_t now_ms() {
+        return pal_osKernelSysMilliSecTick(pal_osKernelSysTick());
+    }
+
+    static bool reconnect(void *context) {
+        SimpleM2MClient *client = (SimpleM2MClient*)context;
+        if (!client->_register_called) {
+            // Closed while the attempt was waiting.
+            return true;
+        }
+        if (mcc_platform_get_network_interface() == NULL && mcc_platform_init_connection() != 0) {
+            return false;
+        }
+        printf("Reconnecting\n");
+        return client->_cloud_client.setup(mcc_platform_get_network_interface());
+    }
+
+    static void reconnect_given_up(void *context) {
+        // Same as an error out of retries, let the application exit.
+        SimpleM2MClient *client = (SimpleM2MClient*)context;
+        client->_register_called = false;
+        client->signal_state_changed();
+    }
+
+    static void scheduled_update(void *context) {
+        ((SimpleM2MClient*)context)->register_update();
+    }
+
+    void signal_state_changed() {
+        if (_state_changed != 0) {
+            pal_osSemaphoreRelease(_state_changed);
         }
-        return cnt;
     }
 
 private:
@@ -280,7 +436,13 @@ private:
     MbedCloudClient     _cloud_client;
     bool                _registered;
     bool                _register_called;
-    uint32_t            _unique_id;
+    uint64_t            _unique_id;
+    palSemaphoreID_t    _state_changed;
+    uint64_t            _register_started;
+    uint32_t            _time_to_registered;
+    M2MResource         *_register_time_res;
+    ReconnectController _reconnect;
+    RegistrationScheduler _updates;
 
 };
 
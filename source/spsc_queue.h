@@ -0,0 +1,166 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Size of a cache line, the indexes of the producer and the consumer are
+// kept this far apart so they do not share one.
+#ifndef SPSC_QUEUE_CACHE_LINE
+#define SPSC_QUEUE_CACHE_LINE 64
+#endif
+
+#if defined (__GNUC__) || defined (__clang__)
+#define SPSC_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SPSC_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SPSC_COMPARE_EXCHANGE(p, expected, desired) \
+    __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+// ARMCC5 and IAR have no __atomic builtins. Their mbed targets are single
+// core, so a critical section orders the access like the builtins do.
+#include "platform/mbed_critical.h"
+
+template <typename T>
+inline T spsc_load_acquire(const T *p)
+{
+    core_util_critical_section_enter();
+    T value = *(const volatile T*)p;
+    core_util_critical_section_exit();
+    return value;
+}
+
+template <typename T, typename V>
+inline void spsc_store_release(T *p, V value)
+{
+    core_util_critical_section_enter();
+    *(volatile T*)p = (T)value;
+    core_util_critical_section_exit();
+}
+
+template <typename T, typename V>
+inline bool spsc_compare_exchange(T *p, T &expected, V desired)
+{
+    core_util_critical_section_enter();
+    bool equal = (*(volatile T*)p == expected);
+    if (equal) {
+        *(volatile T*)p = (T)desired;
+    } else {
+        expected = *(volatile T*)p;
+    }
+    core_util_critical_section_exit();
+    return equal;
+}
+
+#define SPSC_LOAD_ACQUIRE(p)        spsc_load_acquire(p)
+#define SPSC_STORE_RELEASE(p, v)    spsc_store_release((p), (v))
+#define SPSC_COMPARE_EXCHANGE(p, expected, desired) spsc_compare_exchange((p), (expected), (desired))
+#endif
+
+/**
+ * \brief Lock-free queue between exactly one producer thread and one
+ *        consumer thread.
+ *
+ *        The capacity is rounded up to a power of two. Each side also keeps
+ *        a copy of the index of the other one and only reloads it when the
+ *        queue looks full or empty, so most operations touch no shared
+ *        cache line besides the item itself.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    SpscQueue() : _items(NULL), _mask(0), _head(0), _cached_tail(0), _tail(0), _cached_head(0)
+    {
+    }
+
+    ~SpscQueue()
+    {
+        delete[] _items;
+    }
+
+    bool allocate(uint32_t capacity)
+    {
+        uint32_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        delete[] _items;
+        _items = new T[size];
+        _mask = _items ? size - 1 : 0;
+        _head = _cached_tail = _tail = _cached_head = 0;
+        return _items != NULL;
+    }
+
+    /**
+     * \brief Adds an item, producer side only.
+     *
+     * \return false if the queue is full.
+     */
+    bool push(const T &item)
+    {
+        uint32_t tail = _tail;
+        if (tail - _cached_head > _mask) {
+            _cached_head = SPSC_LOAD_ACQUIRE(&_head);
+            if (tail - _cached_head > _mask) {
+                return false;
+            }
+        }
+        _items[tail & _mask] = item;
+        SPSC_STORE_RELEASE(&_tail, tail + 1);
+        return true;
+    }
+
+    /**
+     * \brief Removes the oldest item, consumer side only.
+     *
+     * \return false if the queue is empty.
+     */
+    bool pop(T &item)
+    {
+        uint32_t head = _head;
+        if (head == _cached_tail) {
+            _cached_tail = SPSC_LOAD_ACQUIRE(&_tail);
+            if (head == _cached_tail) {
+                return false;
+            }
+        }
+        item = _items[head & _mask];
+        SPSC_STORE_RELEASE(&_head, head + 1);
+        return true;
+    }
+
+private:
+    T           *_items;
+    uint32_t    _mask;
+
+    // Consumer side.
+    uint32_t    _head;
+    uint32_t    _cached_tail;
+    uint8_t     _consumer_pad[SPSC_QUEUE_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    // Producer side.
+    uint32_t    _tail;
+    uint32_t    _cached_head;
+    uint8_t     _producer_pad[SPSC_QUEUE_CACHE_LINE - 2 * sizeof(uint32_t)];
+};
+
+#endif /* __SPSC_QUEUE_H__ */
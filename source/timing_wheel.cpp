@@ -0,0 +1,243 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "timing_wheel.h"
+
+#include <string.h>
+
+const uint64_t TimingWheel::NO_EVENT;
+
+// Index of the lowest set bit, v must not be zero.
+static int lowest_bit(uint64_t v)
+{
+#if defined (__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int bit = 0;
+    while ((v & 1) == 0) {
+        v >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// Index of the lowest set bit at or above from, or -1 if there is none.
+static int find_from(uint64_t bits, int from)
+{
+    if (from >= TimingWheel::LEVEL_SIZE) {
+        return -1;
+    }
+    bits &= ~(uint64_t)0 << from;
+    return bits ? lowest_bit(bits) : -1;
+}
+
+TimingWheel::TimingWheel()
+{
+    reset(0);
+}
+
+void TimingWheel::reset(uint64_t now)
+{
+    memset(_slots, 0, sizeof(_slots));
+    memset(_occupied, 0, sizeof(_occupied));
+    _now = now;
+    _count = 0;
+}
+
+void TimingWheel::insert(TimerNode &node, uint64_t expires)
+{
+    if (is_scheduled(node)) {
+        remove(node);
+    }
+    node.expires = expires;
+    place(node);
+    _count++;
+}
+
+void TimingWheel::remove(TimerNode &node)
+{
+    if (!is_scheduled(node)) {
+        return;
+    }
+
+    *node.pprev = node.next;
+    if (node.next) {
+        node.next->pprev = node.pprev;
+    }
+
+    // Clear the occupied bit if the node was the last one in its slot.
+    TimerNode **first = &_slots[0][0];
+    if (node.pprev >= first && node.pprev < first + (LEVEL_COUNT * LEVEL_SIZE) && *node.pprev == NULL) {
+        size_t index = node.pprev - first;
+        _occupied[index / LEVEL_SIZE] &= ~((uint64_t)1 << (index % LEVEL_SIZE));
+    }
+
+    node.next = NULL;
+    node.pprev = NULL;
+    _count--;
+}
+
+bool TimingWheel::is_scheduled(const TimerNode &node)
+{
+    return node.pprev != NULL;
+}
+
+void TimingWheel::advance(uint64_t now, expiry_cb cb, void *context)
+{
+    while (_now <= now) {
+        uint64_t next = next_event();
+        if (next > now) {
+            // Nothing to do before now, jump over the empty slots.
+            _now = now + 1;
+            break;
+        }
+        if (next > _now) {
+            _now = next;
+        }
+
+        int slot = _now & LEVEL_MASK;
+        if (slot == 0) {
+            // Level 0 wrapped around, pull the timers of the next slot of
+            // each upper level down for as long as that level wraps too.
+            for (int level = 1; level < LEVEL_COUNT; level++) {
+                cascade(level);
+                if (((_now >> (LEVEL_BITS * level)) & LEVEL_MASK) != 0) {
+                    break;
+                }
+            }
+        }
+
+        // Move the due timers to a local list first, so that the callback can
+        // reschedule them or remove any other timer while we iterate.
+        _now++;
+        TimerNode *pending = _slots[0][slot];
+        _slots[0][slot] = NULL;
+        _occupied[0] &= ~((uint64_t)1 << slot);
+        if (pending) {
+            pending->pprev = &pending;
+        }
+
+        while (pending) {
+            TimerNode *node = pending;
+            pending = node->next;
+            if (pending) {
+                pending->pprev = &pending;
+            }
+            node->next = NULL;
+            node->pprev = NULL;
+            _count--;
+            cb(*node, context);
+        }
+    }
+}
+
+uint64_t TimingWheel::next_event() const
+{
+    if (_count == 0) {
+        return NO_EVENT;
+    }
+
+    uint64_t best = NO_EVENT;
+
+    // Level 0 holds the timers of the next LEVEL_SIZE ticks by their exact tick.
+    int current = _now & LEVEL_MASK;
+    int slot = find_from(_occupied[0], current);
+    if (slot >= 0) {
+        best = (_now & ~(uint64_t)LEVEL_MASK) + slot;
+    } else if (_occupied[0]) {
+        best = (_now & ~(uint64_t)LEVEL_MASK) + LEVEL_SIZE + lowest_bit(_occupied[0]);
+    }
+
+    // Upper levels have work when their slot is cascaded.
+    for (int level = 1; level < LEVEL_COUNT; level++) {
+        if (_occupied[level] == 0) {
+            continue;
+        }
+        int shift = LEVEL_BITS * level;
+        uint64_t unit = _now >> shift;
+        current = unit & LEVEL_MASK;
+
+        // The current slot was already cascaded unless we stand right at its start.
+        bool aligned = (_now & (((uint64_t)1 << shift) - 1)) == 0;
+        slot = find_from(_occupied[level], aligned ? current : current + 1);
+
+        uint64_t when;
+        if (slot >= 0) {
+            when = (unit - current + slot) << shift;
+        } else {
+            when = (unit - current + LEVEL_SIZE + lowest_bit(_occupied[level])) << shift;
+        }
+        if (when < best) {
+            best = when;
+        }
+    }
+
+    return best;
+}
+
+size_t TimingWheel::count() const
+{
+    return _count;
+}
+
+void TimingWheel::place(TimerNode &node)
+{
+    uint64_t expires = (node.expires < _now) ? _now : node.expires;
+    uint64_t delta = expires - _now;
+
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        if (delta < ((uint64_t)1 << (LEVEL_BITS * (level + 1)))) {
+            link(level, (expires >> (LEVEL_BITS * level)) & LEVEL_MASK, node);
+            return;
+        }
+    }
+
+    // Beyond the range of the wheel, park in the farthest slot. The timer is
+    // placed again with its real deadline when that slot is cascaded.
+    expires = _now + ((uint64_t)1 << (LEVEL_BITS * LEVEL_COUNT)) - 1;
+    link(LEVEL_COUNT - 1, (expires >> (LEVEL_BITS * (LEVEL_COUNT - 1))) & LEVEL_MASK, node);
+}
+
+void TimingWheel::cascade(int level)
+{
+    int slot = (_now >> (LEVEL_BITS * level)) & LEVEL_MASK;
+
+    TimerNode *node = _slots[level][slot];
+    _slots[level][slot] = NULL;
+    _occupied[level] &= ~((uint64_t)1 << slot);
+
+    while (node) {
+        TimerNode *next = node->next;
+        place(*node);
+        node = next;
+    }
+}
+
+void TimingWheel::link(int level, int slot, TimerNode &node)
+{
+    TimerNode **head = &_slots[level][slot];
+
+    node.next = *head;
+    if (node.next) {
+        node.next->pprev = &node.next;
+    }
+    node.pprev = head;
+    *head = &node;
+    _occupied[level] |= (uint64_t)1 << slot;
+}
@@ -0,0 +1,108 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __TIMING_WHEEL_H__
+#define __TIMING_WHEEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * \brief Timer embedded into the object it schedules, so inserting and
+ *        removing a timer never allocates.
+ */
+struct TimerNode {
+    TimerNode   *next;
+    TimerNode   **pprev;
+    uint64_t    expires;
+    void        *data;
+};
+
+/**
+ * \brief Hierarchical timing wheel with O(1) insert and remove.
+ *
+ *        Time is counted in ticks, the engine uses one tick per millisecond.
+ *        Four levels of 64 slots cover 2^24 ticks (~4.6 hours at 1 ms),
+ *        timers further away are parked in the last level and cascaded down
+ *        again when their slot comes around. Bitmaps of the occupied slots
+ *        let advance() and next_event() skip the empty parts of the wheel.
+ */
+class TimingWheel
+{
+public:
+    typedef void (*expiry_cb)(TimerNode &node, void *context);
+
+    enum {
+        LEVEL_BITS  = 6,
+        LEVEL_SIZE  = 1 << LEVEL_BITS,
+        LEVEL_MASK  = LEVEL_SIZE - 1,
+        LEVEL_COUNT = 4
+    };
+
+    static const uint64_t NO_EVENT = ~(uint64_t)0;
+
+    TimingWheel();
+
+    /**
+     * \brief Sets the current time, the wheel must be empty.
+     */
+    void reset(uint64_t now);
+
+    /**
+     * \brief Schedules the node to expire at the given tick. A node already
+     *        in the wheel is moved. Deadlines in the past expire on the next
+     *        call to advance().
+     */
+    void insert(TimerNode &node, uint64_t expires);
+
+    /**
+     * \brief Removes the node from the wheel, if it was scheduled.
+     */
+    void remove(TimerNode &node);
+
+    static bool is_scheduled(const TimerNode &node);
+
+    /**
+     * \brief Expires every node due at or before now, calling cb for each of
+     *        them in deadline order. The callback may insert nodes again.
+     */
+    void advance(uint64_t now, expiry_cb cb, void *context);
+
+    /**
+     * \brief Returns the earliest tick at which advance() has work to do,
+     *        or NO_EVENT if the wheel is empty. The returned tick is never
+     *        later than the next deadline, but may be earlier when a slot of
+     *        an upper level has to be cascaded first.
+     */
+    uint64_t next_event() const;
+
+    size_t count() const;
+
+private:
+    void place(TimerNode &node);
+    void cascade(int level);
+    void link(int level, int slot, TimerNode &node);
+
+private:
+    TimerNode   *_slots[LEVEL_COUNT][LEVEL_SIZE];
+    uint64_t    _occupied[LEVEL_COUNT];
+    uint64_t    _now; // next tick to be processed
+    size_t      _count;
+};
+
+#endif /* __TIMING_WHEEL_H__ */
@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+
+## ----------------------------------------------------------------------------
+## Copyright 2018 ARM Ltd.
+##
+## SPDX-License-Identifier: Apache-2.0
+##
+## Licensed under the Apache License, Version 2.0 (the "License");
+## you may not use this file except in compliance with the License.
+## You may obtain a copy of the License at
+##
+##     http://www.apache.org/licenses/LICENSE-2.0
+##
+## Unless required by applicable law or agreed to in writing, software
+## distributed under the License is distributed on an "AS IS" BASIS,
+## WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+## See the License for the specific language governing permissions and
+## limitations under the License.
+## ----------------------------------------------------------------------------
+
+'''
+Builds the product catalog image read by source/product_catalog.cpp from a
+text file with one product name per line. Copy the result as
+product_catalog.bin into the primary partition of the device.
+
+Image layout, all integers 32-bit little endian:
+    "PCAT", version, product count, size of the image
+    offset of the name of each product from the start of the image
+    names, each one a length byte followed by the UTF-8 name
+Products with the same name share one entry in the names. The device keeps
+the index of a product in 16 bits, so a catalog holds at most 65535 products.
+'''
+
+import argparse
+import struct
+import sys
+
+CATALOG_MAGIC = b'PCAT'
+CATALOG_VERSION = 1
+HEADER_SIZE = 16
+MAX_NAME_LENGTH = 255
+MAX_PRODUCTS = 0xFFFF
+
+def build_catalog(names):
+    if len(names) > MAX_PRODUCTS:
+        raise ValueError('%d products, at most %d are supported' % (len(names), MAX_PRODUCTS))
+    names_start = HEADER_SIZE + 4 * len(names)
+    offsets = []
+    interned = {}
+    blob = bytearray()
+
+    for name in names:
+        encoded = name.encode('utf-8')
+        if len(encoded) > MAX_NAME_LENGTH:
+            raise ValueError('product name longer than %d bytes: %s' % (MAX_NAME_LENGTH, name))
+        if encoded not in interned:
+            interned[encoded] = names_start + len(blob)
+            blob += struct.pack('<B', len(encoded)) + encoded
+        offsets.append(interned[encoded])
+
+    size = names_start + len(blob)
+    header = CATALOG_MAGIC + struct.pack('<III', CATALOG_VERSION, len(names), size)
+    index = struct.pack('<%dI' % len(offsets), *offsets)
+    return header + index + bytes(blob)
+
+def main():
+    parser = argparse.ArgumentParser(description='Build a product catalog image.')
+    parser.add_argument('input', help='text file with one product name per line')
+    parser.add_argument('output', help='catalog image to write')
+    args = parser.parse_args()
+
+    with open(args.input, 'rb') as f:
+        names = [line.decode('utf-8').strip() for line in f]
+    names = [name for name in names if name]
+    if not names:
+        print('No products in %s' % args.input)
+        return 1
+
+    image = build_catalog(names)
+    with open(args.output, 'wb') as f:
+        f.write(image)
+
+    print('%d products, %d bytes' % (len(names), len(image)))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
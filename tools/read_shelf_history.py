@@ -0,0 +1,124 @@
+#!/usr/bin/env python
+
+## ----------------------------------------------------------------------------
+## Copyright 2018 ARM Ltd.
+##
+## SPDX-License-Identifier: Apache-2.0
+##
+## Licensed under the Apache License, Version 2.0 (the "License");
+## you may not use this file except in compliance with the License.
+## You may obtain a copy of the License at
+##
+##     http://www.apache.org/licenses/LICENSE-2.0
+##
+## Unless required by applicable law or agreed to in writing, software
+## distributed under the License is distributed on an "AS IS" BASIS,
+## WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+## See the License for the specific language governing permissions and
+## limitations under the License.
+## ----------------------------------------------------------------------------
+
+'''
+Converts the shelf history files written by source/shelf_history.cpp to CSV
+with one "time_ms,shelf,count" line per change, oldest first. Pass the
+shelf_history_*.bin files copied from the primary partition, in any order.
+
+File layout, integers little endian:
+    "SHTS", version byte, 0, shelf count (16 bit), sequence (32 bit)
+    blocks of: record count (16 bit), payload length (32 bit) and payload
+The payload holds three columns of LEB128 varints:
+    time of the first record, then the zig-zag delta of delta of the times
+    shelf of each record
+    zig-zag change from the previous count of the shelf in the block, or 0
+'''
+
+import argparse
+import struct
+import sys
+
+HISTORY_MAGIC = b'SHTS'
+HISTORY_VERSION = 1
+HEADER_SIZE = 12
+BLOCK_HEADER_SIZE = 6
+
+def read_varint(data, position):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[position]
+        position += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, position
+        shift += 7
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+def decode_block(payload, count):
+    position = 0
+    times = []
+    time, position = read_varint(payload, position)
+    times.append(time)
+    delta = 0
+    for _ in range(1, count):
+        value, position = read_varint(payload, position)
+        delta += unzigzag(value)
+        time += delta
+        times.append(time)
+
+    shelves = []
+    for _ in range(count):
+        shelf, position = read_varint(payload, position)
+        shelves.append(shelf)
+
+    last = {}
+    for i in range(count):
+        value, position = read_varint(payload, position)
+        last[shelves[i]] = last.get(shelves[i], 0) + unzigzag(value)
+        yield times[i], shelves[i], last[shelves[i]]
+
+def read_file(name):
+    with open(name, 'rb') as f:
+        data = bytearray(f.read())
+    if len(data) < HEADER_SIZE or bytes(data[0:4]) != HISTORY_MAGIC or data[4] != HISTORY_VERSION:
+        raise ValueError('%s is not a shelf history file' % name)
+    sequence = struct.unpack_from('<I', data, 8)[0]
+
+    records = []
+    position = HEADER_SIZE
+    while position + BLOCK_HEADER_SIZE <= len(data):
+        count, length = struct.unpack_from('<HI', data, position)
+        position += BLOCK_HEADER_SIZE
+        if count == 0 or position + length > len(data):
+            # Torn block at the end of a file still being written.
+            break
+        records.extend(decode_block(data[position:position + length], count))
+        position += length
+    return sequence, records
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert shelf history files to CSV.')
+    parser.add_argument('files', nargs='+', help='shelf history files')
+    parser.add_argument('-o', '--output', help='CSV file to write, standard output by default')
+    args = parser.parse_args()
+
+    files = []
+    for name in args.files:
+        try:
+            files.append(read_file(name))
+        except ValueError as error:
+            sys.stderr.write('%s\n' % error)
+    files.sort(key=lambda entry: entry[0])
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    out.write('time_ms,shelf,count\n')
+    for _, records in files:
+        for time, shelf, count in records:
+            out.write('%d,%d,%d\n' % (time, shelf, count))
+    if args.output:
+        out.close()
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())